@@ -0,0 +1,331 @@
+////////////////////////////////////////
+//
+// Translate the chromosome names of a BigWig file in place
+// --
+// When: 19-oct-2026
+// --
+// Only the chromosome B+ tree is rebuilt. The chromosome ids are kept, so
+// the compressed data blocks and the R-tree indices (which are keyed by
+// id) are copied byte by byte. If the new tree does not fit in the space of
+// the old one, everything after it is shifted and only the file offsets in
+// the header, zoom headers and R-tree nodes are patched while copying.
+//
+// Format reference: Kent et al. BigWig and BigBed. Bioinformatics 2010
+//
+////////////////////////////////////////
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <Rcpp.h>
+using namespace Rcpp;
+
+// [[Rcpp::plugins(cpp11)]]
+
+#define BIGWIG_MAGIC 0x888FFC26
+#define BPT_MAGIC    0x78CA8C91
+#define CIRTREE_MAGIC 0x2468ACE0
+
+template<typename T> static inline T get(const unsigned char *p) { T x; memcpy(&x, p, sizeof(T)); return x; }
+template<typename T> static inline void put(unsigned char *p, T x) { memcpy(p, &x, sizeof(T)); }
+
+// closes the file when leaving the scope, also when stop() throws
+struct FileCloser {
+	FILE *f;
+	~FileCloser() { if(f) fclose(f); }
+};
+
+// read n bytes at a given offset of the file
+static void readAt(FILE *file, uint64_t off, void *buf, size_t n) {
+	if(fseeko(file, off, SEEK_SET) != 0 || fread(buf, 1, n, file) != n)
+		stop("Truncated BigWig file");
+}
+
+/***************************************
+ *
+ * chromosome B+ tree
+ *
+ ***************************************/
+struct Chrom {
+	std::string name;
+	uint32_t id;
+	uint32_t size;
+};
+
+// collect the leaves of the tree rooted at `off`
+static void readChromTree(FILE *file, uint64_t off, uint32_t keySize, std::vector<Chrom>& chroms) {
+
+	unsigned char h[4];
+	readAt(file, off, h, 4);
+	uint16_t count = get<uint16_t>(h + 2);
+	size_t itemSize = keySize + 8;	// key + (id, size) in leaves or key + child offset
+	if(count == 0) return;
+	std::vector<unsigned char> items(count * itemSize);
+	readAt(file, off + 4, &items[0], items.size());
+
+	for(uint16_t i=0; i < count; i++) {
+		const unsigned char *item = &items[i * itemSize];
+		if(h[0]) {
+			Chrom c;
+			c.name.assign((const char *)item, strnlen((const char *)item, keySize));
+			c.id   = get<uint32_t>(item + keySize);
+			c.size = get<uint32_t>(item + keySize + 4);
+			chroms.push_back(c);
+		} else {
+			readChromTree(file, get<uint64_t>(item + keySize), keySize, chroms);
+		}
+	}
+}
+
+// serialize a tree of sorted chromosomes the way the UCSC tools do (bptFileBulkIndex)
+static void writeChromTree(std::vector<unsigned char>& out, uint64_t start, const std::vector<Chrom>& chroms,
+                           uint32_t blockSize, uint32_t keySize) {
+
+	uint64_t n = chroms.size();
+	size_t itemSize = keySize + 8;
+	size_t nodeSize = 4 + blockSize * itemSize;	// index and leaf items have the same size
+
+	int levels = 1;
+	for(uint64_t x=n; x > blockSize; x = (x + blockSize - 1) / blockSize) levels++;
+
+	// header
+	out.assign(32, 0);
+	put<uint32_t>(&out[0], BPT_MAGIC);
+	put<uint32_t>(&out[4], blockSize);
+	put<uint32_t>(&out[8], keySize);
+	put<uint32_t>(&out[12], 8);
+	put<uint64_t>(&out[16], n);
+
+	// index levels, from the root down. Every slot points to the node covering its first key
+	for(int level=levels-1; level > 0; level--) {
+		uint64_t slotSize = 1;
+		for(int i=0; i < level; i++) slotSize *= blockSize;
+		uint64_t nodeItems = slotSize * blockSize;
+		uint64_t nodes = (n + nodeItems - 1) / nodeItems;
+		uint64_t child = start + out.size() + nodes * nodeSize;
+
+		for(uint64_t i=0; i < n; i += nodeItems) {
+			size_t node = out.size();
+			uint16_t count = std::min<uint64_t>(blockSize, (n - i + slotSize - 1) / slotSize);
+			out.resize(node + nodeSize, 0);
+			put<uint16_t>(&out[node + 2], count);
+			for(uint16_t j=0; j < count; j++) {
+				unsigned char *item = &out[node + 4 + j * itemSize];
+				const std::string& key = chroms[i + j * slotSize].name;
+				memcpy(item, key.data(), key.size());
+				put<uint64_t>(item + keySize, child);
+				child += nodeSize;
+			}
+		}
+	}
+
+	// leaves
+	for(uint64_t i=0; i < n; i += blockSize) {
+		size_t node = out.size();
+		uint16_t count = std::min<uint64_t>(blockSize, n - i);
+		out.resize(node + nodeSize, 0);
+		out[node] = 1;
+		put<uint16_t>(&out[node + 2], count);
+		for(uint16_t j=0; j < count; j++) {
+			unsigned char *item = &out[node + 4 + j * itemSize];
+			const Chrom& c = chroms[i + j];
+			memcpy(item, c.name.data(), c.name.size());
+			put<uint32_t>(item + keySize, c.id);
+			put<uint32_t>(item + keySize + 4, c.size);
+		}
+	}
+}
+
+/***************************************
+ *
+ * offsets to be rewritten when the data is shifted
+ *
+ ***************************************/
+typedef std::map<uint64_t, uint64_t> Patches;	// file offset of a 64 bits field -> new value
+
+// the data offsets of the leaves and the child offsets of the nodes of an R-tree
+static void patchRTree(FILE *file, uint64_t off, uint64_t delta, Patches& patches) {
+
+	unsigned char h[4];
+	readAt(file, off, h, 4);
+	uint16_t count = get<uint16_t>(h + 2);
+	size_t itemSize = h[0] ? 32 : 24;	// 4 x 32 bits bounds + data offset & size, or + child offset
+	if(count == 0) return;
+	std::vector<unsigned char> items(count * itemSize);
+	readAt(file, off + 4, &items[0], items.size());
+
+	for(uint16_t i=0; i < count; i++) {
+		uint64_t x = get<uint64_t>(&items[i * itemSize + 16]);
+		patches[off + 4 + i * itemSize + 16] = x + delta;
+		if(!h[0]) patchRTree(file, x, delta, patches);
+	}
+}
+
+static void patchIndex(FILE *file, uint64_t off, uint64_t delta, Patches& patches) {
+
+	unsigned char h[48];
+	readAt(file, off, h, 48);
+	if(get<uint32_t>(h) != CIRTREE_MAGIC) stop("Corrupted BigWig R-tree index");
+	patches[off + 32] = get<uint64_t>(h + 32) + delta;	// end of the data it indexes
+	patchRTree(file, off + 48, delta, patches);
+}
+
+// apply the patches falling into buf, which holds the bytes [off, off + n) of the input
+static void applyPatches(const Patches& patches, uint64_t off, unsigned char *buf, size_t n) {
+
+	for(Patches::const_iterator p=patches.lower_bound(off < 7 ? 0 : off - 7); p != patches.end() && p->first < off + n; ++p) {
+		unsigned char x[8];
+		put<uint64_t>(x, p->second);
+		for(int i=0; i < 8; i++) {
+			if(p->first + i >= off && p->first + i < off + n) buf[p->first + i - off] = x[i];
+		}
+	}
+}
+
+/***************************************
+ *
+ * translate the chromosome names of a BigWig file
+ *
+ ***************************************/
+// [[Rcpp::export]]
+void translateBigWig(std::string in, std::string out, CharacterVector from, CharacterVector to) {
+
+	if(from.size() != to.size()) stop("The translation table must have 2 columns");
+	std::map<std::string, std::string> table;
+	for(int i=0; i < (int)from.size(); i++) table[as<std::string>(from[i])] = as<std::string>(to[i]);
+
+	FILE *file = NULL;
+	if((file = fopen(in.c_str(), "rb")) == NULL) {
+		stop("Could not open specified file");
+	}
+	FileCloser closeIn = { file };
+
+	/*
+	 * header, zoom headers and extension header
+	 */
+	unsigned char header[64];
+	readAt(file, 0, header, 64);
+	if(get<uint32_t>(header) != BIGWIG_MAGIC) {
+		stop("Input is not a BigWig file (or it is byte-swapped)");
+	}
+	uint16_t zoomLevels  = get<uint16_t>(header + 6);
+	uint64_t chromTree   = get<uint64_t>(header + 8);
+	uint64_t fullData    = get<uint64_t>(header + 16);
+	uint64_t fullIndex   = get<uint64_t>(header + 24);
+	uint64_t extension   = get<uint64_t>(header + 56);
+
+	std::vector<unsigned char> zooms(24 * zoomLevels + 1);
+	readAt(file, 64, &zooms[0], 24 * zoomLevels);
+
+	unsigned char ext[12] = { 0 };
+	if(extension) readAt(file, extension, ext, 12);
+
+	/*
+	 * old chromosome tree, renamed and sorted by the new names
+	 */
+	unsigned char bpt[32];
+	readAt(file, chromTree, bpt, 32);
+	if(get<uint32_t>(bpt) != BPT_MAGIC) {
+		stop("Corrupted BigWig chromosome tree");
+	}
+	uint32_t blockSize = get<uint32_t>(bpt + 4);
+	uint32_t keySize   = get<uint32_t>(bpt + 8);
+
+	std::vector<Chrom> chroms;
+	readChromTree(file, chromTree + 32, keySize, chroms);
+	for(size_t i=0; i < chroms.size(); i++) {
+		std::map<std::string, std::string>::const_iterator t = table.find(chroms[i].name);
+		if(t != table.end()) chroms[i].name = t->second;
+		keySize = std::max<uint32_t>(keySize, chroms[i].name.size());
+	}
+
+	// keys are compared as zero padded byte strings; only re-sort if the new names changed the order
+	auto byName = [](const Chrom& x, const Chrom& y) { return x.name < y.name; };
+	if(!std::is_sorted(chroms.begin(), chroms.end(), byName)) std::sort(chroms.begin(), chroms.end(), byName);
+	for(size_t i=1; i < chroms.size(); i++) {
+		if(chroms[i].name == chroms[i-1].name) {
+				stop("Translation maps 2 chromosomes to the same name: " + chroms[i].name);
+		}
+	}
+
+	std::vector<unsigned char> tree;
+	writeChromTree(tree, chromTree, chroms, blockSize, keySize);
+
+	/*
+	 * the new tree is zero padded to the size of the old one. If it doesn't fit,
+	 * shift everything after it and collect the offsets to be patched
+	 */
+	uint64_t oldSize = fullData - chromTree;
+	uint64_t delta   = tree.size() > oldSize ? tree.size() - oldSize : 0;
+	tree.resize(oldSize + delta, 0);
+
+	Patches patches;
+	if(delta) {
+		const int fields[] = { 16, 24, 36, 44, 56 };	// fullData, fullIndex, autoSql, totalSummary, extension
+		for(int i=0; i < 5; i++) {
+			uint64_t x = get<uint64_t>(header + fields[i]);
+			if(x >= fullData) put<uint64_t>(header + fields[i], x + delta);
+		}
+		for(int i=0; i < zoomLevels; i++) {
+			unsigned char *z = &zooms[24 * i];
+			patchIndex(file, get<uint64_t>(z + 16), delta, patches);
+			put<uint64_t>(z + 8,  get<uint64_t>(z + 8)  + delta);
+			put<uint64_t>(z + 16, get<uint64_t>(z + 16) + delta);
+		}
+		if(extension && get<uint16_t>(ext + 2) > 0) {
+				stop("BigWig files with extra indices are not supported");
+		}
+		patchIndex(file, fullIndex, delta, patches);
+	}
+
+	/*
+	 * write the output: patched headers, the rest of the head verbatim, the new tree and the
+	 * data + indices copied in big chunks
+	 */
+	// written next to the output and renamed at the end: in == out doesn't truncate the input
+	// while it's being read, and a failure doesn't leave a partial file behind
+	std::string tmp = out + ".tmp" + std::to_string(getpid());
+	FILE *fout = NULL;
+	if((fout = fopen(tmp.c_str(), "wb")) == NULL) {
+		stop("Could not open output file");
+	}
+
+	bool ok = true;
+	try {
+		std::vector<unsigned char> buf(8 << 20);
+		ok = ok && fwrite(header, 1, 64, fout) == 64;
+		ok = ok && fwrite(&zooms[0], 1, 24 * zoomLevels, fout) == (size_t)24 * zoomLevels;
+		for(uint64_t off=64 + 24 * zoomLevels; ok && off < chromTree; ) {
+			size_t n = std::min<uint64_t>(buf.size(), chromTree - off);
+			readAt(file, off, &buf[0], n);
+			ok = fwrite(&buf[0], 1, n, fout) == n;
+			off += n;
+		}
+		ok = ok && fwrite(&tree[0], 1, tree.size(), fout) == tree.size();
+
+		fseeko(file, fullData, SEEK_SET);
+		for(uint64_t off=fullData; ok; ) {
+			size_t n = fread(&buf[0], 1, buf.size(), file);
+			if(n == 0) break;
+			applyPatches(patches, off, &buf[0], n);
+			ok = fwrite(&buf[0], 1, n, fout) == n;
+			off += n;
+		}
+		ok = !ferror(file) && ok;
+	} catch(...) {
+		fclose(fout);
+		unlink(tmp.c_str());
+		throw;
+	}
+
+	ok = fclose(fout) == 0 && ok;
+	if(!ok || rename(tmp.c_str(), out.c_str()) != 0) {
+		unlink(tmp.c_str());
+		stop("Could not write output file");
+	}
+}
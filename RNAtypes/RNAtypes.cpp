@@ -0,0 +1,505 @@
+////////////////////////////////////////
+//
+// Native biotype counter for RNAtypes.R
+// --
+// When: 19-oct-2026
+// --
+// The GTF features of type `ftype` are flattened per gene (like
+// reduce(split(gtf, gene_id)) does) and compiled into one implicit
+// interval tree per chromosome and strand: a start-sorted array where
+// every node also keeps the max end of its subtree. Every BAM is then
+// streamed once: BGZF blocks are inflated in parallel and the decoded
+// records are split among the threads to be overlapped with the trees.
+//
+// The counting modes mimic the ones in RNAtypes.R:
+//   *ALL:         every (read, feature) hit is counted
+//   *UNAMBIGUOUS: only reads hitting exactly one feature are counted
+//   *NONE:        like UNAMBIGUOUS, but only for reads with NH == 1
+//   *RANDOM:      reads falling completely within a feature count once
+//
+////////////////////////////////////////
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <algorithm>
+#include <thread>
+#include <Rcpp.h>
+#include "bam.h"	// BGZF/BAM reader shared with chipqc (common/bam.h)
+using namespace Rcpp;
+
+// [[Rcpp::plugins(cpp11)]]
+
+// value of the NH tag, 1 if missing
+static int bamNH(const char *r) {
+
+	const char *end = r + get<int32_t>(r - 4);
+	int32_t lseq = get<int32_t>(r + 16);
+	const char *p = bamCigar(r) + 4 * bamNcigar(r) + (lseq + 1) / 2 + lseq;
+
+	while(p + 3 <= end) {
+		char type = p[2];
+		bool nh = p[0] == 'N' && p[1] == 'H';
+		p += 3;
+		switch(type) {
+			case 'A': case 'c': case 'C':
+				if(nh) return type == 'c' ? (int8_t)p[0] : (uint8_t)p[0];
+				p += 1; break;
+			case 's': case 'S':
+				if(nh) return type == 's' ? get<int16_t>(p) : get<uint16_t>(p);
+				p += 2; break;
+			case 'i': case 'I':
+				if(nh) return type == 'i' ? get<int32_t>(p) : (int)get<uint32_t>(p);
+				p += 4; break;
+			case 'f':
+				p += 4; break;
+			case 'Z': case 'H':
+				while(p < end && *p) p++;
+				p++; break;
+			case 'B': {
+				int size = strchr("cC", p[0]) ? 1 : strchr("sS", p[0]) ? 2 : 4;
+				p += 5 + size * get<int32_t>(p + 1);
+				break;
+			}
+			default:
+				return 1;
+		}
+	}
+	return 1;
+}
+
+/***************************************
+ *
+ * implicit interval tree over a start-sorted array of half-open intervals
+ * (the node at index i sits at level = number of trailing 1 bits of i)
+ *
+ ***************************************/
+struct Interval {
+	int32_t st, en;	// 0-based, half-open
+	int32_t max;	// max end in the subtree rooted here
+	int32_t id;		// index of the flattened feature
+};
+
+class ITree {
+public:
+	std::vector<Interval> a;
+
+	void index() {
+
+		std::sort(a.begin(), a.end(), [](const Interval& x, const Interval& y) { return x.st < y.st; });
+		level = -1;
+		if(a.empty()) return;
+
+		int64_t n = a.size(), i, lastI = 0;
+		int32_t last = 0;
+		for(i=0; i < n; i += 2) { lastI = i; last = a[i].max = a[i].en; }	// leaves
+		int k;
+		for(k=1; (int64_t)1 << k <= n; k++) {
+			int64_t x = (int64_t)1 << (k - 1), i0 = (x << 1) - 1, step = x << 2;
+			for(i=i0; i < n; i += step) {
+				int32_t el = a[i - x].max;
+				int32_t er = i + x < n ? a[i + x].max : last;
+				a[i].max = std::max(a[i].en, std::max(el, er));
+			}
+			lastI = (lastI >> k & 1) ? lastI - x : lastI + x;
+			if(lastI < n && a[lastI].max > last) last = a[lastI].max;
+		}
+		level = k - 1;
+	}
+
+	// call f(interval) for every interval overlapping [st, en)
+	template<typename F>
+	void overlap(int32_t st, int32_t en, F f) const {
+
+		if(level < 0) return;
+		struct Node { int64_t x; int k, w; } stack[64];
+		int64_t n = a.size();
+		int t = 0;
+		stack[t++] = Node{ ((int64_t)1 << level) - 1, level, 0 };
+		while(t) {
+			Node z = stack[--t];
+			if(z.k <= 3) {	// small subtree: scan it linearly
+				int64_t i0 = z.x >> z.k << z.k, i1 = std::min(n, i0 + ((int64_t)1 << (z.k + 1)) - 1);
+				for(int64_t i=i0; i < i1 && a[i].st < en; i++) {
+					if(st < a[i].en) f(a[i]);
+				}
+			} else if(z.w == 0) {	// visit the left child first
+				int64_t y = z.x - ((int64_t)1 << (z.k - 1));
+				stack[t++] = Node{ z.x, z.k, 1 };
+				if(y >= n || a[y].max > st) stack[t++] = Node{ y, z.k - 1, 0 };
+			} else if(z.x < n && a[z.x].st < en) {	// this node, then the right child
+				if(st < a[z.x].en) f(a[z.x]);
+				stack[t++] = Node{ z.x + ((int64_t)1 << (z.k - 1)), z.k - 1, 0 };
+			}
+		}
+	}
+
+private:
+	int level = -1;
+};
+
+/***************************************
+ *
+ * annotation: flattened features, their biotypes and the trees
+ *
+ ***************************************/
+struct Annotation {
+	std::vector<std::string> biotypes;	// biotype names
+	std::vector<double> width;			// total flattened width per biotype
+	std::vector<int> biotype;			// biotype of every flattened feature (-1 if unknown)
+	std::map<std::string, int> chroms;	// chromosome name -> index in trees
+	std::vector<ITree> trees;			// 2 trees (+/-) per chromosome
+};
+
+// value of the attribute `key` in the 9th column of a GTF line
+static bool gtfAttr(const char *p, const std::string& key, std::string& val) {
+
+	while(*p) {
+		while(*p == ' ' || *p == ';') p++;
+		const char *k = p;
+		while(*p && *p != ' ' && *p != ';') p++;
+		bool match = (size_t)(p - k) == key.size() && strncmp(k, key.c_str(), key.size()) == 0;
+		while(*p == ' ') p++;
+		const char *v = p;
+		if(*p == '"') {
+			v = ++p;
+			while(*p && *p != '"') p++;
+		} else {
+			while(*p && *p != ';') p++;
+		}
+		if(match) { val.assign(v, p - v); return true; }
+		if(*p == '"') p++;
+	}
+	return false;
+}
+
+static void loadGTF(const std::string& gtf, const std::string& ftype, const std::string& ftypecol, Annotation& ann) {
+
+	gzFile gz = gzopen(gtf.c_str(), "rb");
+	if(gz == NULL) stop("Could not open specified GTF file");
+	gzbuffer(gz, 1 << 20);
+
+	struct Raw { int gene, chrom, strand; int32_t st, en; };
+	std::vector<Raw> raw;
+	std::unordered_map<std::string, int> genes, types;
+	std::vector<int> geneType;
+	bool hasType = false;
+
+	std::vector<char> line(1 << 20);
+	std::string gene, type;
+	while(gzgets(gz, &line[0], line.size()) != NULL) {
+		if(line[0] == '#') continue;
+		char *f[9], *p = &line[0];
+		int i;
+		for(i=0; i < 9 && p; i++) {
+			f[i] = p;
+			if((p = strchr(p, '\t')) != NULL) *p++ = '\0';
+		}
+		if(i < 9 || ftype != f[2]) continue;
+		f[8][strcspn(f[8], "\r\n")] = '\0';
+		if(!gtfAttr(f[8], "gene_id", gene)) continue;
+
+		// the biotype of the gene is taken from its first feature
+		auto g = genes.find(gene);
+		if(g == genes.end()) {
+			int t = -1;
+			if(gtfAttr(f[8], ftypecol, type)) {
+				auto it = types.insert(std::make_pair(type, (int)types.size())).first;
+				if(it->second == (int)ann.biotypes.size()) ann.biotypes.push_back(type);
+				t = it->second;
+				hasType = true;
+			}
+			g = genes.insert(std::make_pair(gene, (int)geneType.size())).first;
+			geneType.push_back(t);
+		}
+
+		auto c = ann.chroms.insert(std::make_pair(std::string(f[0]), (int)ann.chroms.size())).first;
+		Raw r = { g->second, c->second, f[6][0] == '+' ? 0 : f[6][0] == '-' ? 1 : 2, atoi(f[3]) - 1, atoi(f[4]) };
+		raw.push_back(r);
+	}
+	gzclose(gz);
+	if(!hasType) stop("GTF file doesn't contain info about the biotype");
+
+	// flatten: merge overlapping or adjacent features of the same gene, chromosome and strand
+	std::sort(raw.begin(), raw.end(), [](const Raw& x, const Raw& y) {
+		if(x.gene   != y.gene)   return x.gene   < y.gene;
+		if(x.chrom  != y.chrom)  return x.chrom  < y.chrom;
+		if(x.strand != y.strand) return x.strand < y.strand;
+		return x.st < y.st;
+	});
+
+	ann.trees.resize(2 * ann.chroms.size());
+	ann.width.assign(ann.biotypes.size(), 0);
+	for(size_t i=0; i < raw.size(); ) {
+		Raw m = raw[i];
+		for(i++; i < raw.size() && raw[i].gene == m.gene && raw[i].chrom == m.chrom &&
+		         raw[i].strand == m.strand && raw[i].st <= m.en; i++) {
+			m.en = std::max(m.en, raw[i].en);
+		}
+
+		int id = ann.biotype.size(), t = geneType[m.gene];
+		ann.biotype.push_back(t);
+		if(t >= 0) ann.width[t] += m.en - m.st;
+
+		// unstranded features go to both trees; hits are deduplicated later
+		Interval x = { m.st, m.en, m.en, id };
+		if(m.strand != 1) ann.trees[2 * m.chrom    ].a.push_back(x);
+		if(m.strand != 0) ann.trees[2 * m.chrom + 1].a.push_back(x);
+	}
+	for(size_t i=0; i < ann.trees.size(); i++) ann.trees[i].index();
+}
+
+/***************************************
+ *
+ * counting
+ *
+ ***************************************/
+enum Multimap { ALL, UNAMBIGUOUS, NONE, RANDOM };
+
+struct Options {
+	bool paired;
+	int  stranded;	// 0: no, 1: yes, 2: reverse
+	Multimap multimap;
+	int  threads;
+};
+
+class Counter {
+public:
+	Counter(const Annotation& ann, const Options& opt) : ann(ann), opt(opt) {}
+
+	// count reads per biotype in a single pass over the BAM file
+	std::vector<double> count(const std::string& f) {
+
+		BAM bam(f, opt.threads);
+
+		// map the BAM references to the annotated chromosomes
+		tid.assign(bam.refs.size(), -1);
+		for(size_t i=0; i < bam.refs.size(); i++) {
+			auto c = ann.chroms.find(bam.refs[i]);
+			if(c != ann.chroms.end()) tid[i] = c->second;
+		}
+
+		std::vector<std::vector<double> > counts(opt.threads, std::vector<double>(ann.biotypes.size(), 0));
+		std::vector<std::vector<int> > hits;
+		std::vector<const char *> recs;
+		pending.clear();
+
+		while(bam.next(recs)) {
+			if(opt.paired) hits.resize(recs.size());
+			parallelFor(opt.threads, recs.size(), [&](size_t b, size_t e, int t) {
+				std::vector<int> h;
+				for(size_t i=b; i < e; i++) {
+					if(opt.paired) {
+						hits[i].clear();
+						if(opt.multimap != RANDOM) overlaps(recs[i], hits[i]);
+					} else {
+						single(recs[i], h, counts[t]);
+					}
+				}
+			});
+			if(opt.paired) {
+				for(size_t i=0; i < recs.size(); i++) pair(recs[i], hits[i], counts[0]);
+			}
+			checkUserInterrupt();
+		}
+
+		for(int t=1; t < opt.threads; t++) {
+			for(size_t i=0; i < counts[0].size(); i++) counts[0][i] += counts[t][i];
+		}
+		return counts[0];
+	}
+
+private:
+	const Annotation& ann;
+	const Options& opt;
+	std::vector<int> tid;
+
+	// the first mate seen of a pair, waiting for the other one
+	struct Mate { std::vector<int> hits; int32_t st, en; int strand, nh; bool first; };
+	std::unordered_map<std::string, Mate> pending;
+
+	// annotated chromosome of a reference id, -1 if not annotated or out of the BAM dictionary
+	int chrom(int32_t t) const {
+		return t >= 0 && (size_t)t < tid.size() ? tid[t] : -1;
+	}
+
+	// strand (0: +, 1: -) the read has to be matched against
+	int strand(const char *r) const {
+		uint16_t flag = bamFlag(r);
+		int s = (flag & 0x10) ? 1 : 0;
+		if(opt.paired && (flag & 0x80)) s ^= 1;	// the last mate is on the opposite strand of the pair
+		if(opt.stranded == 2) s ^= 1;
+		return s;
+	}
+
+	// reference end of the alignment (D and N consume the reference)
+	static int32_t refEnd(const char *r) {
+		const char *c = bamCigar(r);
+		int32_t end = bamPos(r);
+		for(int i=0; i < bamNcigar(r); i++) {
+			uint32_t op = get<uint32_t>(c + 4 * i);
+			if(strchr("MDN=X", CIGAR[op & 0xf])) end += op >> 4;
+		}
+		return end;
+	}
+
+	// call f(tree) for the trees a read is compared with
+	template<typename F>
+	void trees(int chrom, int s, F f) const {
+		if(opt.stranded == 0 || s == 0) f(ann.trees[2 * chrom]);
+		if(opt.stranded == 0 || s == 1) f(ann.trees[2 * chrom + 1]);
+	}
+
+	// unique features overlapped by the blocks of the alignment (split only at N)
+	void overlaps(const char *r, std::vector<int>& h) const {
+
+		int t = chrom(bamTid(r));
+		if(t < 0 || (bamFlag(r) & 0x4)) return;
+
+		const char *c = bamCigar(r);
+		int32_t st = bamPos(r), en = st;
+		int s = strand(r);
+		size_t h0 = h.size();
+		auto add = [&](int32_t b, int32_t e) {
+			if(e > b) trees(t, s, [&](const ITree& tree) {
+				tree.overlap(b, e, [&](const Interval& x) { h.push_back(x.id); });
+			});
+		};
+		for(int i=0; i < bamNcigar(r); i++) {
+			uint32_t op = get<uint32_t>(c + 4 * i);
+			switch(CIGAR[op & 0xf]) {
+				case 'M': case 'D': case '=': case 'X':
+					en += op >> 4; break;
+				case 'N':
+					add(st, en);
+					st = en = en + (op >> 4);
+					break;
+			}
+		}
+		add(st, en);
+		std::sort(h.begin() + h0, h.end());
+		h.erase(std::unique(h.begin() + h0, h.end()), h.end());
+	}
+
+	// first feature containing [st, en) completely
+	int within(int chrom, int s, int32_t st, int32_t en) const {
+		int id = -1;
+		trees(chrom, s, [&](const ITree& tree) {
+			tree.overlap(st, en, [&](const Interval& x) {
+				if(id < 0 && x.st <= st && en <= x.en) id = x.id;
+			});
+		});
+		return id;
+	}
+
+	void add(const std::vector<int>& h, std::vector<double>& counts) const {
+		if(opt.multimap == ALL) {
+			for(size_t i=0; i < h.size(); i++) {
+				if(ann.biotype[h[i]] >= 0) counts[ann.biotype[h[i]]]++;
+			}
+		} else if(h.size() == 1 && ann.biotype[h[0]] >= 0) {
+			counts[ann.biotype[h[0]]]++;
+		}
+	}
+
+	void single(const char *r, std::vector<int>& h, std::vector<double>& counts) const {
+
+		int t = chrom(bamTid(r));
+		if((bamFlag(r) & 0x4) || t < 0) return;
+		if(opt.multimap == NONE && bamNH(r) != 1) return;
+
+		if(opt.multimap == RANDOM) {
+			int id = within(t, strand(r), bamPos(r), refEnd(r));
+			if(id >= 0 && ann.biotype[id] >= 0) counts[ann.biotype[id]]++;
+		} else {
+			h.clear();
+			overlaps(r, h);
+			add(h, counts);
+		}
+	}
+
+	// mates are matched by name, positions and the secondary flag (runs sequentially)
+	void pair(const char *r, std::vector<int>& h, std::vector<double>& counts) {
+
+		uint16_t flag = bamFlag(r);
+		if((flag & 0x80D) != 0x1 || !(flag & 0xC0)) return;	// paired, both mapped, not supplementary
+
+		bool first = flag & 0x40;
+		int32_t c[4] = { bamTid(r), bamPos(r), bamMtid(r), bamMpos(r) };
+		if(!first) { std::swap(c[0], c[2]); std::swap(c[1], c[3]); }
+		std::string key(bamName(r));
+		key.append((const char *)c, sizeof(c));
+		key.push_back(flag & 0x100 ? 'S' : 'P');
+
+		auto it = pending.find(key);
+		if(it == pending.end()) {
+			Mate m;
+			m.hits.swap(h);
+			m.st     = bamPos(r);
+			m.en     = refEnd(r);
+			m.strand = strand(r);
+			m.nh     = bamNH(r);
+			m.first  = first;
+			pending.insert(std::make_pair(key, std::move(m)));
+			return;
+		}
+
+		// both mates seen: strand and NH of the pair are the ones of the first mate
+		Mate& m = it->second;
+		int s  = m.first ? m.strand : strand(r);
+		int nh = m.first ? m.nh : bamNH(r);
+		if(opt.multimap == NONE && nh != 1) { pending.erase(it); return; }
+
+		if(opt.multimap == RANDOM) {
+			int t = chrom(bamTid(r));
+			if(bamTid(r) == bamMtid(r) && t >= 0) {
+				int id = within(t, s, std::min(m.st, bamPos(r)), std::max(m.en, refEnd(r)));
+				if(id >= 0 && ann.biotype[id] >= 0) counts[ann.biotype[id]]++;
+			}
+		} else {
+			m.hits.insert(m.hits.end(), h.begin(), h.end());
+			std::sort(m.hits.begin(), m.hits.end());
+			m.hits.erase(std::unique(m.hits.begin(), m.hits.end()), m.hits.end());
+			add(m.hits, counts);
+		}
+		pending.erase(it);
+	}
+};
+
+/***************************************
+ *
+ * count the biotypes in a set of BAM files
+ *
+ ***************************************/
+// [[Rcpp::export]]
+Rcpp::List countRNAtypes(CharacterVector files, std::string gtf, std::string ftype, std::string ftypecol,
+                         std::string paired, std::string stranded, std::string multimap, int cores) {
+
+	Options opt;
+	opt.paired   = paired == "yes";
+	opt.stranded = stranded == "yes" ? 1 : stranded == "reverse" ? 2 : 0;
+	opt.multimap = multimap == "ALL" ? ALL : multimap == "UNAMBIGUOUS" ? UNAMBIGUOUS : multimap == "RANDOM" ? RANDOM : NONE;
+	opt.threads  = cores < 1 ? 1 : cores;
+
+	Annotation ann;
+	loadGTF(gtf, ftype, ftypecol, ann);
+
+	// one row per file, one column per biotype
+	Counter counter(ann, opt);
+	Rcpp::NumericMatrix counts(files.size(), ann.biotypes.size());
+	for(int i=0; i < (int)files.size(); i++) {
+		std::vector<double> x = counter.count(as<std::string>(files[i]));
+		for(size_t j=0; j < x.size(); j++) counts(i, j) = x[j];
+	}
+
+	Rcpp::List li = Rcpp::List::create(
+		Rcpp::Named("biotypes") = Rcpp::CharacterVector(ann.biotypes.begin(), ann.biotypes.end()),
+		Rcpp::Named("width")    = Rcpp::NumericVector(ann.width.begin(), ann.width.end()),
+		Rcpp::Named("counts")   = counts);
+
+	return li;
+}
@@ -0,0 +1,392 @@
+////////////////////////////////////////
+//
+// Read start extractor for the chipqc scripts
+// --
+// When: 19-oct-2026
+// --
+// PBC.R, IPstrength.R and phantompeak.R only need the strand-aware 5'
+// position of every read. extractReadStarts() decodes the BAM once
+// (BGZF blocks inflated in parallel) and writes them to a small file that
+// the three scripts read with readStarts(), instead of decoding the BAM
+// three times.
+//
+// Unmapped alignments are skipped, as well as the ones below the mapping
+// quality threshold. Secondary and supplementary alignments are kept, like
+// readGAlignments() and spp's read.bam.tags() do, unless primary = TRUE.
+// The 5' position of a read is its (1-based) start on the + strand. On the
+// - strand it is the alignment end (like GenomicAlignments' end(), used by
+// PBC.R and IPstrength.R), and spp's pos + qwidth - 1 is kept as well for
+// phantompeak.R. With the defaults, every script gets the reads and the
+// metric it used to compute from the BAM.
+//
+// File layout (little endian, meant to be mmap'ed):
+//   header:  "RSTARTS3", min mapq, primary alignments only, number of
+//            chromosomes, number of reads
+//   one directory entry per chromosome: name offset and length, chromosome
+//            length, and for each stream (+, - alignment end, - spp end) the
+//            number of positions, offset and size of its data, and offset
+//            of its mapping qualities
+//   chromosome names
+//   data:    sorted positions of each chromosome and stream, encoded as
+//            the difference to the previous one in LEB128 varints (1 byte
+//            for duplicates and neighbouring reads), followed by the
+//            mapping quality of each one (1 byte)
+//
+////////////////////////////////////////
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <Rcpp.h>
+#include "bam.h"	// BGZF/BAM reader shared with RNAtypes (common/bam.h)
+using namespace Rcpp;
+
+// [[Rcpp::plugins(cpp11)]]
+
+// query length (M, I, S, = and X), what spp calls qwidth
+static int32_t bamQwidth(const char *r) {
+	int32_t w = 0;
+	const char *c = bamCigar(r);
+	for(int k=0; k < bamNcigar(r); k++) {
+		uint32_t op = get<uint32_t>(c + 4 * k);
+		if(strchr("MIS=X", CIGAR[op & 0xf])) w += op >> 4;
+	}
+	return w;
+}
+
+// reference bases covered (M, D, N, = and X)
+static int32_t bamSpan(const char *r) {
+	int32_t w = 0;
+	const char *c = bamCigar(r);
+	for(int k=0; k < bamNcigar(r); k++) {
+		uint32_t op = get<uint32_t>(c + 4 * k);
+		if(strchr("MDN=X", CIGAR[op & 0xf])) w += op >> 4;
+	}
+	return w;
+}
+
+/***************************************
+ *
+ * run f(i) for i in [0, n), biggest jobs first (eg. chr1 before chrM)
+ *
+ ***************************************/
+template<typename F>
+static void parallelJobs(int threads, const std::vector<size_t>& size, F f) {
+
+	std::vector<size_t> order(size.size());
+	for(size_t i=0; i < order.size(); i++) order[i] = i;
+	std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return size[a] > size[b]; });
+
+	std::atomic<size_t> next(0);
+	auto worker = [&]() {
+		for(size_t k; (k = next++) < order.size(); ) f(order[k]);
+	};
+	std::vector<std::thread> pool;
+	for(int t=1; t < std::min(threads, (int)order.size()); t++) pool.push_back(std::thread(worker));
+	worker();
+	for(size_t t=0; t < pool.size(); t++) pool[t].join();
+}
+
+/***************************************
+ *
+ * file format
+ *
+ ***************************************/
+#define STARTS_MAGIC "RSTARTS3"
+
+// position streams of every chromosome
+enum { PLUS, MINUS, MINUS_SPP, STREAMS };
+
+struct StartsHeader {
+	char     magic[8];
+	uint32_t minMapq;
+	uint32_t primary;	// secondary and supplementary alignments skipped
+	uint32_t nchrom;
+	uint32_t unused;
+	uint64_t nreads;
+};
+
+struct StartsChrom {
+	uint64_t name;		// offset of the name
+	uint32_t nameLen;
+	uint32_t length;	// chromosome length
+	uint64_t n[STREAMS];		// positions in every stream
+	uint64_t offset[STREAMS];	// offset of the encoded positions
+	uint64_t bytes[STREAMS];
+	uint64_t mapq[STREAMS];		// offset of the n mapping qualities (1 byte each)
+};
+
+// tags are sorted as (position, mapq) pairs packed in one integer
+static inline uint64_t tag(int32_t pos, uint8_t mapq) { return (uint64_t)(uint32_t)pos << 8 | mapq; }
+
+static void encode(const std::vector<uint64_t>& tags, std::vector<uint8_t>& out) {
+	out.clear();
+	uint32_t last = 0;
+	for(size_t i=0; i < tags.size(); i++) {
+		uint32_t pos = tags[i] >> 8, d = pos - last;
+		last = pos;
+		while(d >= 0x80) { out.push_back(d | 0x80); d >>= 7; }
+		out.push_back(d);
+	}
+	for(size_t i=0; i < tags.size(); i++) out.push_back(tags[i] & 0xff);
+}
+
+static const uint8_t *decode(const uint8_t *p, uint32_t& x) {
+	uint32_t d = 0;
+	for(int shift=0; ; shift += 7) {
+		d |= (uint32_t)(*p & 0x7f) << shift;
+		if(!(*p++ & 0x80)) break;
+	}
+	x += d;
+	return p;
+}
+
+/***************************************
+ *
+ * extraction
+ *
+ ***************************************/
+// [[Rcpp::export]]
+double extractReadStarts(std::string bam, std::string out, int minMapq = 0, int cores = 1, bool primary = false) {
+
+	int threads = cores < 1 ? 1 : cores;
+	BAM in(bam, threads);
+	size_t nref = in.refs.size();
+	uint16_t skip = primary ? 0x904 : 0x4;	// unmapped (and secondary, supplementary)
+
+	// every thread collects its own tags per chromosome and stream (STREAMS * tid + stream)
+	std::vector<std::vector<std::vector<uint64_t> > > local(threads, std::vector<std::vector<uint64_t> >(STREAMS * nref));
+	std::vector<const char *> recs;
+	while(in.next(recs)) {
+		parallelFor(threads, recs.size(), [&](size_t b, size_t e, int t) {
+			for(size_t i=b; i < e; i++) {
+				const char *r = recs[i];
+				int32_t tid = bamTid(r);
+				if(tid < 0 || (size_t)tid >= nref || (bamFlag(r) & skip) || bamMapq(r) < minMapq) continue;
+
+				std::vector<uint64_t> *x = &local[t][STREAMS * tid];
+				if(!(bamFlag(r) & 0x10)) {
+					x[PLUS].push_back(tag(bamPos(r) + 1, bamMapq(r)));
+					continue;
+				}
+				x[MINUS].push_back(tag(bamPos(r) + std::max(bamSpan(r), 1), bamMapq(r)));
+				x[MINUS_SPP].push_back(tag(bamPos(r) + std::max(bamQwidth(r), 1), bamMapq(r)));
+			}
+		});
+	}
+
+	// merge the threads, sort and encode every chromosome and stream
+	std::vector<size_t> size(STREAMS * nref, 0);
+	for(int t=0; t < threads; t++) {
+		for(size_t j=0; j < STREAMS * nref; j++) size[j] += local[t][j].size();
+	}
+	std::vector<std::vector<uint8_t> > data(STREAMS * nref);
+	parallelJobs(threads, size, [&](size_t j) {
+		std::vector<uint64_t> tags;
+		tags.reserve(size[j]);
+		for(int t=0; t < threads; t++) {
+			tags.insert(tags.end(), local[t][j].begin(), local[t][j].end());
+			std::vector<uint64_t>().swap(local[t][j]);
+		}
+		std::sort(tags.begin(), tags.end());
+		encode(tags, data[j]);
+	});
+
+	// directory, names and data
+	StartsHeader h;
+	memcpy(h.magic, STARTS_MAGIC, 8);
+	h.minMapq = minMapq;
+	h.primary = primary;
+	h.unused  = 0;
+	h.nchrom  = nref;
+	h.nreads  = 0;
+	std::vector<StartsChrom> dir(nref);
+	std::string names;
+	uint64_t offset = sizeof(StartsHeader) + nref * sizeof(StartsChrom);
+	for(size_t i=0; i < nref; i++) {
+		dir[i].name    = offset + names.size();
+		dir[i].nameLen = in.refs[i].size();
+		dir[i].length  = in.lens[i];
+		names += in.refs[i];
+	}
+	offset += names.size();
+	for(size_t i=0; i < nref; i++) {
+		for(int s=0; s < STREAMS; s++) {
+			dir[i].n[s]      = size[STREAMS * i + s];
+			dir[i].offset[s] = offset;
+			dir[i].bytes[s]  = data[STREAMS * i + s].size() - dir[i].n[s];
+			dir[i].mapq[s]   = offset + dir[i].bytes[s];
+			offset += data[STREAMS * i + s].size();
+		}
+		h.nreads += dir[i].n[PLUS] + dir[i].n[MINUS];
+	}
+
+	// write next to the destination and rename, so concurrent readers never see a partial file
+	std::string tmp = out + ".tmp" + std::to_string(getpid());
+	FILE *f = fopen(tmp.c_str(), "wb");
+	if(f == NULL) stop("Could not write " + out);
+	bool ok = fwrite(&h, sizeof(h), 1, f) == 1 &&
+	          (nref == 0 || fwrite(&dir[0], sizeof(StartsChrom), nref, f) == nref) &&
+	          fwrite(names.data(), 1, names.size(), f) == names.size();
+	for(size_t j=0; ok && j < data.size(); j++) {
+		ok = fwrite(data[j].data(), 1, data[j].size(), f) == data[j].size();
+	}
+	if(fclose(f) != 0 || !ok || rename(tmp.c_str(), out.c_str()) != 0) {
+		unlink(tmp.c_str());
+		stop("Could not write " + out);
+	}
+
+	return h.nreads;
+}
+
+/***************************************
+ *
+ * reading: the file is mapped and the chromosomes decoded in parallel
+ *
+ ***************************************/
+class StartsFile {
+public:
+	const StartsHeader *h;
+	const StartsChrom  *dir;
+
+	StartsFile(const std::string& f) : data(NULL), bytes(0) {
+		int fd = open(f.c_str(), O_RDONLY);
+		struct stat st;
+		if(fd < 0 || fstat(fd, &st) != 0) {
+			if(fd >= 0) close(fd);
+			stop("Could not open " + f);
+		}
+		bytes = st.st_size;
+		data  = bytes ? (const uint8_t *)mmap(NULL, bytes, PROT_READ, MAP_PRIVATE, fd, 0) : (const uint8_t *)MAP_FAILED;
+		close(fd);
+		if(data == MAP_FAILED) stop("Could not open " + f);
+
+		h   = (const StartsHeader *)data;
+		dir = (const StartsChrom *)(data + sizeof(StartsHeader));
+		if(bytes < sizeof(StartsHeader) || memcmp(h->magic, STARTS_MAGIC, 8) != 0 ||
+		   (bytes - sizeof(StartsHeader)) / sizeof(StartsChrom) < h->nchrom) {
+			munmap((void *)data, bytes);
+			stop(f + " is not a read starts file");
+		}
+		for(uint32_t i=0; i < h->nchrom; i++) {
+			bool ok = dir[i].name <= bytes && dir[i].nameLen <= bytes - dir[i].name;
+			for(int s=0; s < STREAMS; s++) {
+				ok = ok && dir[i].offset[s] <= bytes && dir[i].bytes[s] <= bytes - dir[i].offset[s] &&
+				     dir[i].mapq[s] <= bytes && dir[i].n[s] <= bytes - dir[i].mapq[s];
+			}
+			if(!ok) {
+				munmap((void *)data, bytes);
+				stop("Truncated read starts file " + f);
+			}
+		}
+	}
+	~StartsFile() { munmap((void *)data, bytes); }
+
+	std::string name(int i) const { return std::string((const char *)data + dir[i].name, dir[i].nameLen); }
+	const uint8_t *positions(int i, int stream) const { return data + dir[i].offset[stream]; }
+	const uint8_t *mapq(int i, int stream) const { return data + dir[i].mapq[stream]; }
+
+private:
+	const uint8_t *data;
+	size_t bytes;
+};
+
+// chromosome lengths, and number of reads per strand
+// [[Rcpp::export]]
+Rcpp::DataFrame readStartsInfo(std::string file) {
+
+	StartsFile in(file);
+	int n = in.h->nchrom;
+	Rcpp::CharacterVector chrom(n);
+	Rcpp::IntegerVector   length(n);
+	Rcpp::NumericVector   plus(n);
+	Rcpp::NumericVector   minus(n);
+	for(int i=0; i < n; i++) {
+		chrom[i]  = in.name(i);
+		length[i] = in.dir[i].length;
+		plus[i]   = in.dir[i].n[PLUS];
+		minus[i]  = in.dir[i].n[MINUS];
+	}
+
+	Rcpp::DataFrame df = Rcpp::DataFrame::create(
+		Rcpp::Named("chrom")  = chrom,
+		Rcpp::Named("length") = length,
+		Rcpp::Named("plus")   = plus,
+		Rcpp::Named("minus")  = minus,
+		Rcpp::Named("stringsAsFactors") = false);
+
+	df.attr("minMapq") = (int)in.h->minMapq;
+	df.attr("primary") = (bool)in.h->primary;
+	return df;
+}
+
+// read starts per chromosome (the ones with reads) like spp's read.bam.tags():
+// + strand positive, - strand negative, sorted by position. The - strand 5'
+// end is the alignment end, or pos + qwidth - 1 (soft clips and insertions
+// included) like spp does if spp = TRUE, and then the mapping quality of
+// every tag goes in $quality too
+// [[Rcpp::export]]
+Rcpp::List readStarts(std::string file, int cores = 1, bool spp = false) {
+
+	StartsFile in(file);
+	int minus = spp ? MINUS_SPP : MINUS;
+	std::vector<int> chroms;
+	std::vector<size_t> size;
+	for(uint32_t i=0; i < in.h->nchrom; i++) {
+		if(in.dir[i].n[PLUS] + in.dir[i].n[minus] == 0) continue;
+		chroms.push_back(i);
+		size.push_back(in.dir[i].n[PLUS] + in.dir[i].n[minus]);
+	}
+
+	// allocate in R, fill from the threads
+	Rcpp::List tags(chroms.size()), quality(spp ? chroms.size() : 0);
+	Rcpp::CharacterVector names(chroms.size());
+	std::vector<int *> out(chroms.size()), outq(chroms.size(), (int *)NULL);
+	for(size_t k=0; k < chroms.size(); k++) {
+		Rcpp::IntegerVector x(size[k]);
+		out[k]   = x.begin();
+		tags[k]  = x;
+		names[k] = in.name(chroms[k]);
+		if(spp) {
+			Rcpp::IntegerVector q(size[k]);
+			outq[k]    = q.begin();
+			quality[k] = q;
+		}
+	}
+	tags.attr("names") = names;
+
+	parallelJobs(cores < 1 ? 1 : cores, size, [&](size_t k) {
+		const StartsChrom& c = in.dir[chroms[k]];
+		const uint8_t *p = in.positions(chroms[k], PLUS), *m = in.positions(chroms[k], minus);
+		const uint8_t *pq = in.mapq(chroms[k], PLUS), *mq = in.mapq(chroms[k], minus);
+		uint32_t x = 0, y = 0;
+		uint64_t i = 0, j = 0, np = c.n[PLUS], nm = c.n[minus];
+		int *q = outq[k];
+		if(np) p = decode(p, x);
+		if(nm) m = decode(m, y);
+		for(int *o=out[k]; i < np || j < nm; o++) {	// merge both strands, + first on ties
+			if(j >= nm || (i < np && x <= y)) {
+				*o = x;
+				if(q) *q++ = pq[i];
+				if(++i < np) p = decode(p, x);
+			} else {
+				*o = -(int)y;
+				if(q) *q++ = mq[j];
+				if(++j < nm) m = decode(m, y);
+			}
+		}
+	});
+
+	if(!spp) return Rcpp::List::create(Rcpp::Named("tags") = tags);
+	quality.attr("names") = names;
+	return Rcpp::List::create(Rcpp::Named("tags") = tags, Rcpp::Named("quality") = quality);
+}
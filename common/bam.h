@@ -0,0 +1,210 @@
+////////////////////////////////////////
+//
+// Minimal parallel BAM reader shared by the native tools
+// (RNAtypes/RNAtypes.cpp, chipqc/readstarts.cpp)
+// --
+// When: 19-oct-2026
+// --
+// The BGZF blocks are inflated in parallel, and the records handed out in
+// batches of pointers into the decoded buffer. The R scripts compiling the
+// tools with sourceCpp() add this folder to PKG_CPPFLAGS.
+//
+////////////////////////////////////////
+#ifndef COMMON_BAM_H
+#define COMMON_BAM_H
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <zlib.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <thread>
+#include <Rcpp.h>
+
+/***************************************
+ *
+ * run f(begin, end, thread) over [0, n) split in `threads` slices
+ *
+ ***************************************/
+template<typename F>
+static void parallelFor(int threads, size_t n, F f) {
+
+	if(threads <= 1 || n < (size_t)threads * 2) {
+		f((size_t)0, n, 0);
+		return;
+	}
+
+	std::vector<std::thread> pool;
+	size_t step = (n + threads - 1) / threads;
+	for(int t=0; t < threads; t++) {
+		size_t b = t * step, e = std::min(n, b + step);
+		if(b >= e) break;
+		pool.push_back(std::thread(f, b, e, t));
+	}
+	for(size_t t=0; t < pool.size(); t++) pool[t].join();
+}
+
+/***************************************
+ *
+ * BGZF reader: blocks are read sequentially and inflated in parallel
+ *
+ ***************************************/
+class BGZF {
+public:
+	BGZF(const std::string& f, int threads) : threads(threads < 1 ? 1 : threads) {
+		file = fopen(f.c_str(), "rb");
+	}
+	~BGZF() { if(file) fclose(file); }
+	bool ok() const { return file != NULL; }
+
+	// append the next batch of inflated blocks to `out`. Returns false at EOF
+	bool read(std::vector<char>& out) {
+
+		static const size_t BATCH = 16 << 20;	// compressed bytes per batch
+		struct Block { size_t coff, clen, uoff, ulen; };
+		std::vector<Block> blocks;
+		size_t n = 0, u = out.size();
+		unsigned char h[12], x[256];
+
+		cdata.resize(BATCH + 65536);
+		while(n < BATCH) {
+			// gzip header with the BC extra subfield holding the block size
+			if(fread(h, 1, 12, file) != 12) break;
+			if(h[0] != 31 || h[1] != 139 || h[2] != 8 || !(h[3] & 4))
+				Rcpp::stop("Input is not a BGZF compressed file");
+			size_t xlen = h[10] | h[11] << 8, bsize = 0;
+			if(xlen > sizeof(x) || fread(x, 1, xlen, file) != xlen)
+				Rcpp::stop("Truncated BGZF block");
+			for(size_t i=0; i + 4 <= xlen; i += 4 + (x[i+2] | x[i+3] << 8)) {
+				if(x[i] == 66 && x[i+1] == 67) bsize = (x[i+4] | x[i+5] << 8) + 1;
+			}
+			if(bsize < 12 + xlen + 8) Rcpp::stop("Input is not a BGZF compressed file");
+
+			// deflated data + crc32 + isize
+			size_t rest = bsize - 12 - xlen;
+			if(fread(&cdata[n], 1, rest, file) != rest) Rcpp::stop("Truncated BGZF block");
+			unsigned char *t = &cdata[n + rest - 4];
+			Block b = { n, rest - 8, u, (size_t)(t[0] | t[1] << 8 | t[2] << 16 | (uint32_t)t[3] << 24) };
+			blocks.push_back(b);
+			n += rest;
+			u += b.ulen;
+		}
+		if(blocks.empty()) return false;
+
+		// every block knows where its output goes, so threads write in place
+		size_t start = out.size();
+		out.resize(u);
+		std::vector<int> err(threads, 0);
+		parallelFor(threads, blocks.size(), [&](size_t b, size_t e, int t) {
+			z_stream z;
+			memset(&z, 0, sizeof(z));
+			if(inflateInit2(&z, -15) != Z_OK) { err[t] = 1; return; }
+			for(size_t i=b; i < e && !err[t]; i++) {
+				if(blocks[i].ulen == 0) continue;	// EOF marker block
+				inflateReset(&z);
+				z.next_in   = &cdata[blocks[i].coff];
+				z.avail_in  = blocks[i].clen;
+				z.next_out  = (Bytef *)&out[blocks[i].uoff];
+				z.avail_out = blocks[i].ulen;
+				if(inflate(&z, Z_FINISH) != Z_STREAM_END || z.avail_out != 0) err[t] = 1;
+			}
+			inflateEnd(&z);
+		});
+		for(int t=0; t < threads; t++) {
+			if(err[t]) Rcpp::stop("Corrupted BGZF block");
+		}
+		return u > start || !feof(file);
+	}
+
+private:
+	FILE *file;
+	int threads;
+	std::vector<unsigned char> cdata;
+};
+
+/***************************************
+ *
+ * BAM reader: header + batches of complete records
+ *
+ ***************************************/
+template<typename T> static inline T get(const char *p) { T x; memcpy(&x, p, sizeof(T)); return x; }
+
+static const char CIGAR[] = "MIDNSHP=X#######";	// op codes, padded for the invalid ones
+
+class BAM {
+public:
+	std::vector<std::string> refs;
+	std::vector<int32_t> lens;	// reference lengths
+
+	BAM(const std::string& f, int threads) : bgzf(f, threads), pos(0), eof(false) {
+		if(!bgzf.ok()) Rcpp::stop("Could not open specified file");
+
+		// magic, plain text header and the reference dictionary
+		need(8);
+		if(memcmp(&buf[0], "BAM\1", 4) != 0) Rcpp::stop("Input is not a BAM file");
+		int32_t ltext = get<int32_t>(&buf[4]);
+		need(8 + ltext + 4);
+		pos = 8 + ltext;
+		int32_t nref = get<int32_t>(&buf[pos]);
+		pos += 4;
+		for(int32_t i=0; i < nref; i++) {
+			need(pos + 4);
+			int32_t lname = get<int32_t>(&buf[pos]);
+			need(pos + 4 + lname + 4);
+			refs.push_back(std::string(&buf[pos + 4]));
+			lens.push_back(get<int32_t>(&buf[pos + 4 + lname]));
+			pos += 4 + lname + 4;
+		}
+	}
+
+	// pointers (past block_size) to the next batch of records, valid until the next call
+	bool next(std::vector<const char *>& recs) {
+
+		recs.clear();
+		while(recs.empty()) {
+			buf.erase(buf.begin(), buf.begin() + pos);
+			pos = 0;
+			if(!eof) eof = !bgzf.read(buf);
+
+			while(pos + 4 <= buf.size()) {
+				int32_t bs = get<int32_t>(&buf[pos]);
+				if(bs < 32) Rcpp::stop("Corrupted BAM record");
+				if(pos + 4 + bs > buf.size()) break;
+				recs.push_back(&buf[pos + 4]);
+				pos += 4 + bs;
+			}
+			if(eof) {
+				if(recs.empty() && pos < buf.size()) Rcpp::stop("Truncated BAM file");
+				break;
+			}
+		}
+		return !recs.empty();
+	}
+
+private:
+	BGZF bgzf;
+	std::vector<char> buf;
+	size_t pos;
+	bool eof;
+
+	void need(size_t n) {
+		while(buf.size() < n) {
+			if(!bgzf.read(buf)) Rcpp::stop("Truncated BAM header");
+		}
+	}
+};
+
+// BAM record fields (rec points past block_size)
+static inline int32_t  bamTid  (const char *r) { return get<int32_t>(r); }
+static inline int32_t  bamPos  (const char *r) { return get<int32_t>(r + 4); }
+static inline uint8_t  bamMapq (const char *r) { return (uint8_t)r[9]; }
+static inline uint16_t bamFlag (const char *r) { return get<uint16_t>(r + 14); }
+static inline int32_t  bamMtid (const char *r) { return get<int32_t>(r + 20); }
+static inline int32_t  bamMpos (const char *r) { return get<int32_t>(r + 24); }
+static inline const char *bamName (const char *r) { return r + 32; }
+static inline const char *bamCigar(const char *r) { return r + 32 + (uint8_t)r[8]; }
+static inline uint16_t bamNcigar(const char *r) { return get<uint16_t>(r + 12); }
+
+#endif
@@ -0,0 +1,255 @@
+///////////////////////////////////////////////////////////////////////////////
+// Pairwise Hamming distances for a set of DNA barcodes of the same length.
+//
+// Barcodes are packed at 2 bits per base (plus a mask for N), so comparing
+// two barcodes of up to 32 bases is a XOR and a popcount (a single POPCNT
+// instruction: app.R builds this file with -mpopcnt when the CPU supports
+// it). Sets with any other symbol (lowercase, IUPAC codes, '-'...) are
+// compared byte by byte instead, so every symbol is still its own character.
+// The i < j pairs are walked in square tiles that fit in L1, spread over
+// threads, and only the histogram and the pairs closer than the minimum
+// distance are kept. No NxN matrix is built. Adding barcodes to an existing
+// set only compares the new barcodes.
+// --
+// What:   dnabarcodes/hamming.cpp
+// When:   2026-10-19
+///////////////////////////////////////////////////////////////////////////////
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <Rcpp.h>
+using namespace Rcpp;
+
+// [[Rcpp::plugins(cpp11)]]
+
+#define TILE 256	// barcodes per tile side
+
+struct Conflict {
+	int i, j, distance;
+};
+
+struct Barcodes {
+	int len;	// bases per barcode
+	int words;	// 64 bits words per barcode
+	int n;		// number of barcodes
+	int threads;
+	std::vector<uint64_t> code;	// n * words, 2 bits per base
+	std::vector<uint64_t> nmask;	// n * words, low bit of the pair set for N
+	std::string bytes;	// n * len, the barcodes as given
+	bool packed;	// only A, C, G, T and N so far: compare code and nmask
+	std::vector<double> hist;	// number of pairs at distance 0..len
+
+	int minDist;	// conflicts are kept for this minimum distance
+	std::vector<Conflict> conflicts;
+};
+
+// pack the barcodes at the end of the set, after checking all of them
+static void pack(Barcodes& bc, CharacterVector seqs) {
+
+	for(int k=0; k < seqs.size(); k++) {
+		if((int)as<std::string>(seqs[k]).size() != bc.len)
+			stop("All barcodes should be of the same length");
+	}
+
+	for(int k=0; k < seqs.size(); k++) {
+		std::string s = as<std::string>(seqs[k]);
+		bc.bytes += s;
+		if(s.find_first_not_of("ACGTN") != std::string::npos) bc.packed = false;
+	}
+	bc.n += seqs.size();
+
+	// anything else than ACGTN: the set is compared byte by byte from now on
+	if(!bc.packed) {
+		std::vector<uint64_t>().swap(bc.code);
+		std::vector<uint64_t>().swap(bc.nmask);
+		return;
+	}
+
+	int first = bc.n - seqs.size();
+	bc.code.resize((size_t)bc.n * bc.words, 0);
+	bc.nmask.resize((size_t)bc.n * bc.words, 0);
+	for(int k=first; k < bc.n; k++) {
+		const char *s = &bc.bytes[(size_t)k * bc.len];
+		uint64_t *c = &bc.code [(size_t)k * bc.words];
+		uint64_t *m = &bc.nmask[(size_t)k * bc.words];
+		for(int p=0; p < bc.len; p++) {
+			uint64_t x;
+			switch(s[p]) {
+				case 'A': x = 0; break;
+				case 'C': x = 1; break;
+				case 'G': x = 2; break;
+				case 'T': x = 3; break;
+				default:  x = 0; m[p / 32] |= (uint64_t)1 << (2 * (p % 32));	// N
+			}
+			c[p / 32] |= x << (2 * (p % 32));
+		}
+	}
+}
+
+// a base differs if any bit of its pair differs, or only one of both is N
+template<int W>
+static inline int distance(const Barcodes& bc, int i, int j) {
+
+	static const uint64_t LOW = 0x5555555555555555ULL;
+	int words = W ? W : bc.words, d = 0;
+	const uint64_t *a  = &bc.code [(size_t)i * words], *b  = &bc.code [(size_t)j * words];
+	const uint64_t *na = &bc.nmask[(size_t)i * words], *nb = &bc.nmask[(size_t)j * words];
+	for(int w=0; w < words; w++) {
+		uint64_t x = a[w] ^ b[w];
+		d += __builtin_popcountll(((x | x >> 1) & LOW) | (na[w] ^ nb[w]));
+	}
+	return d;
+}
+
+// byte by byte, for the sets with other symbols
+static inline int distanceBytes(const Barcodes& bc, int i, int j) {
+	const char *a = &bc.bytes[(size_t)i * bc.len], *b = &bc.bytes[(size_t)j * bc.len];
+	int d = 0;
+	for(int p=0; p < bc.len; p++) d += a[p] != b[p];
+	return d;
+}
+
+// compare all pairs i < j with j >= first, updating the conflicts (and the histogram if asked).
+// W: words per barcode (0: any), -1: byte by byte
+template<int W>
+static void scan(Barcodes& bc, int first, bool histogram) {
+
+	int tiles = (bc.n + TILE - 1) / TILE;
+	std::vector<std::pair<int, int> > work;	// (row tile, col tile) with new columns
+	for(int tj=first / TILE; tj < tiles; tj++) {
+		for(int ti=0; ti <= tj; ti++) work.push_back(std::make_pair(ti, tj));
+	}
+
+	int threads = std::max(1, std::min(bc.threads, (int)work.size()));
+	std::vector<std::vector<double> > hist(threads, std::vector<double>(bc.len + 1, 0));
+	std::vector<std::vector<Conflict> > conflicts(threads);
+	std::atomic<size_t> next(0);
+
+	auto worker = [&](int t) {
+		std::vector<double>& h = hist[t];
+		for(size_t k; (k = next++) < work.size(); ) {
+			int i0 = work[k].first * TILE, i1 = std::min(bc.n, i0 + TILE);
+			int j0 = std::max(first, work[k].second * TILE), j1 = std::min(bc.n, work[k].second * TILE + TILE);
+			for(int i=i0; i < i1; i++) {
+				for(int j=std::max(j0, i + 1); j < j1; j++) {
+					int d = W < 0 ? distanceBytes(bc, i, j) : distance<W>(bc, i, j);
+					h[d]++;
+					if(d < bc.minDist) conflicts[t].push_back(Conflict{ i, j, d });
+				}
+			}
+		}
+	};
+	std::vector<std::thread> pool;
+	for(int t=1; t < threads; t++) pool.push_back(std::thread(worker, t));
+	worker(0);
+	for(size_t t=0; t < pool.size(); t++) pool[t].join();
+
+	for(int t=0; t < threads; t++) {
+		for(int d=0; histogram && d <= bc.len; d++) bc.hist[d] += hist[t][d];
+		bc.conflicts.insert(bc.conflicts.end(), conflicts[t].begin(), conflicts[t].end());
+	}
+}
+
+static void scan(Barcodes& bc, int first, bool histogram = true) {
+	if(!bc.packed) {
+		scan<-1>(bc, first, histogram);
+		return;
+	}
+	switch(bc.words) {
+		case 1:  scan<1>(bc, first, histogram); break;
+		case 2:  scan<2>(bc, first, histogram); break;
+		default: scan<0>(bc, first, histogram);
+	}
+}
+
+/***************************************
+ *
+ * R interface: the set lives in an external pointer
+ *
+ ***************************************/
+// [[Rcpp::export]]
+SEXP hammingCreate(CharacterVector seqs, int threads = 0) {
+
+	if(seqs.size() == 0) stop("No barcodes found");
+
+	Barcodes *bc = new Barcodes;
+	bc->len     = as<std::string>(seqs[0]).size();
+	bc->words   = std::max(1, (bc->len + 31) / 32);
+	bc->n       = 0;
+	bc->packed  = true;
+	bc->threads = threads > 0 ? threads : std::max(1u, std::thread::hardware_concurrency());
+	bc->minDist = 0;
+	bc->hist.assign(bc->len + 1, 0);
+	Rcpp::XPtr<Barcodes> ptr(bc, true);
+
+	pack(*bc, seqs);
+	scan(*bc, 0);
+	return ptr;
+}
+
+// [[Rcpp::export]]
+void hammingAdd(SEXP set, CharacterVector seqs) {
+
+	Rcpp::XPtr<Barcodes> bc(set);
+	int first = bc->n;
+	pack(*bc, seqs);
+	scan(*bc, first);
+}
+
+// [[Rcpp::export]]
+Rcpp::NumericVector hammingHistogram(SEXP set) {
+
+	Rcpp::XPtr<Barcodes> bc(set);
+	return Rcpp::NumericVector(bc->hist.begin(), bc->hist.end());
+}
+
+// pairs (1-based) at distance < minDist; only rescans the set if minDist grows
+// [[Rcpp::export]]
+Rcpp::DataFrame hammingConflicts(SEXP set, int minDist) {
+
+	Rcpp::XPtr<Barcodes> bc(set);
+	if(minDist > bc->minDist) {
+		bc->minDist = minDist;
+		bc->conflicts.clear();
+		scan(*bc, 0, false);
+	}
+
+	int l = 0;
+	for(size_t k=0; k < bc->conflicts.size(); k++) l += bc->conflicts[k].distance < minDist;
+
+	Rcpp::IntegerVector i(l);
+	Rcpp::IntegerVector j(l);
+	Rcpp::IntegerVector distance(l);
+	for(size_t k=0, x=0; k < bc->conflicts.size(); k++) {
+		const Conflict& c = bc->conflicts[k];
+		if(c.distance >= minDist) continue;
+		i[x]        = c.i + 1;
+		j[x]        = c.j + 1;
+		distance[x] = c.distance;
+		x++;
+	}
+
+	Rcpp::DataFrame df = Rcpp::DataFrame::create(
+		Rcpp::Named("i")        = i,
+		Rcpp::Named("j")        = j,
+		Rcpp::Named("distance") = distance);
+
+	return df;
+}
+
+// full matrix, only meant for small sets (heatmap)
+// [[Rcpp::export]]
+Rcpp::IntegerMatrix hammingMatrix(SEXP set) {
+
+	Rcpp::XPtr<Barcodes> bc(set);
+	Rcpp::IntegerMatrix m(bc->n, bc->n);
+	for(int i=0; i < bc->n; i++) {
+		for(int j=i + 1; j < bc->n; j++) {
+			m(i, j) = m(j, i) = bc->packed ? distance<0>(*bc, i, j) : distanceBytes(*bc, i, j);
+		}
+	}
+	return m;
+}
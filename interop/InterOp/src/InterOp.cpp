@@ -2,6 +2,8 @@
 #include <stdlib.h>
 #include <sys/stat.h>
 #include <Rcpp.h>
+#include "RecordFile.h"
+#include "InterOpRecords.h"
 using namespace Rcpp;
 
 /***************************************
@@ -15,39 +17,14 @@ Rcpp::DataFrame readExtractionMetrics(CharacterVector f) {
 	std::string fx = as<std::string>(f[0]);
 	
 	/*
-	 * register definition
+	 * register definition: ExtractionMetrics in InterOpRecords.h
 	 */
-	typedef unsigned char BYTE;
-	BYTE version;	// byte 0: file version number (3)
-	BYTE length;	// byte 1: length of each record
-	// bytes (N * 38 + 2) - (N * 38 + 39): record: (N is the record index)
-	#pragma pack(push, 1)
-	struct ExtractionMetrics {
-		uint16_t lane;	// 2 bytes: lane number
-		uint16_t tile;	// 2 bytes: tile number
-		uint16_t cycle;	// 2 bytes: cycle number
-		//unsigned char padding[2];		// here the struct should be padded, but the file is not
-		float    fwhmA;	// 4 bytes: fwhm scores for channel A respectively
-		float    fwhmC;	// 4 bytes: fwhm scores for channel C respectively
-		float    fwhmG;	// 4 bytes: fwhm scores for channel G respectively
-		float    fwhmT;	// 4 bytes: fwhm scores for channel T respectively
-		uint16_t intA;	// 2 bytes: intensities for channel A respectively
-		uint16_t intC;	// 2 bytes: intensities for channel C respectively
-		uint16_t intG;	// 2 bytes: intensities for channel G respectively
-		uint16_t intT;	// 2 bytes: intensities for channel T respectively
-		uint64_t datetime;	// 8 bytes: date/time of CIF creation (.Net timestamp (100 nanosec tics from 01-01-0001))
-		};
-	#pragma pack(pop)
-	ExtractionMetrics reg;
 	
 	/*
 	 * output data structures: vectors that will be put together into a df
 	 */
-	struct stat st;
-	if(stat(fx.c_str(), &st) != 0) {
-		stop("Could not open specified file");
-	}
-	int l = (st.st_size - 2) / sizeof(reg) + 1;
+	RecordFile in(fx, sizeof(ExtractionMetrics));
+	int l = in.n;
 
 	Rcpp::IntegerVector lane(l);
 	Rcpp::IntegerVector tile(l);
@@ -63,40 +40,34 @@ Rcpp::DataFrame readExtractionMetrics(CharacterVector f) {
 	Rcpp::NumericVector datetime(l);	// 64 bits number. Unset the 2 most significant bits to get the 100 nanosec ticks since 01-01-0001
 
 	/*
-	 * read input and feed the output structure
+	 * decode the records: every thread fills its own slice of the output vectors
 	 */
-	// open input file handle
-	FILE *file = NULL;
-	if ((file = fopen(fx.c_str(), "rb")) == NULL) {
-		stop("Could not open specified file");
-	}
-
-	// read version and register length
-	int r;
-	r = fread(&version, 1, 1, file);
-	r = fread(&length, 1, 1, file);
-
-	// loop over the registers
-	int i = 0;
-	while(!feof(file)) {
-		r = fread(&reg, sizeof(reg), 1, file);
-		lane[i]      = reg.lane;
-		tile[i]      = reg.tile;
-		cycle[i]     = reg.cycle;
-		fwhmA[i]     = reg.fwhmA;
-		fwhmC[i]     = reg.fwhmC;
-		fwhmG[i]     = reg.fwhmG;
-		fwhmT[i]     = reg.fwhmT;
-		intA[i]      = reg.intA;
-		intC[i]      = reg.intC;
-		intG[i]      = reg.intG;
-		intT[i]      = reg.intT;
-		datetime[i]  = reg.datetime & 0x3FFFFFFFFFFFFFFF; // remove the first 2 bits of this 64bit number (useless flags)
-		i++;
-	}
-	
-	// close the file and return the data frame
-	fclose(file);
+	int    *lane_     = lane.begin();
+	int    *tile_     = tile.begin();
+	int    *cycle_    = cycle.begin();
+	double *fwhmA_    = fwhmA.begin();
+	double *fwhmC_    = fwhmC.begin();
+	double *fwhmG_    = fwhmG.begin();
+	double *fwhmT_    = fwhmT.begin();
+	int    *intA_     = intA.begin();
+	int    *intC_     = intC.begin();
+	int    *intG_     = intG.begin();
+	int    *intT_     = intT.begin();
+	double *datetime_ = datetime.begin();
+	decodeRecords<ExtractionMetrics>(in, [&](int i, const ExtractionMetrics& reg) {
+		lane_[i]     = reg.lane;
+		tile_[i]     = reg.tile;
+		cycle_[i]    = reg.cycle;
+		fwhmA_[i]    = reg.fwhmA;
+		fwhmC_[i]    = reg.fwhmC;
+		fwhmG_[i]    = reg.fwhmG;
+		fwhmT_[i]    = reg.fwhmT;
+		intA_[i]     = reg.intA;
+		intC_[i]     = reg.intC;
+		intG_[i]     = reg.intG;
+		intT_[i]     = reg.intT;
+		datetime_[i] = reg.datetime & 0x3FFFFFFFFFFFFFFF; // remove the first 2 bits of this 64bit number (useless flags)
+	});
 
 	Rcpp::DataFrame df = Rcpp::DataFrame::create(
 		Rcpp::Named("lane")     = lane,
@@ -126,30 +97,14 @@ Rcpp::List readQualityMetrics(CharacterVector f) {
 	std::string fx = as<std::string>(f[0]);
 	
 	/*
-	 * register definition
+	 * register definition: QualityMetrics in InterOpRecords.h
 	 */
-	typedef unsigned char BYTE;
-	BYTE version;	// byte 0: file version number (3)
-	BYTE length;	// byte 1: length of each record
-	// bytes (N * 206 + 2) - (N * 206 + 207): record: (N is the record index)
-	#pragma pack(push, 1)
-	struct QualityMetrics {
-		uint16_t lane;	// 2 bytes: lane number
-		uint16_t tile;	// 2 bytes: tile number
-		uint16_t cycle;	// 2 bytes: metric cycle
-		uint32_t nclust[50];	// number of clusters assigned score Q1 through Q50
-		};
- 	#pragma pack(pop)
- 	QualityMetrics reg;
 	
 	/*
 	 * output data structures: vectors that will be put together into a df
 	 */
-	struct stat st;
-	if(stat(fx.c_str(), &st) != 0) {
-		stop("Could not open specified file");
-	}
-	int l = (st.st_size - 2) / sizeof(reg) + 1;
+	RecordFile in(fx, sizeof(QualityMetrics));
+	int l = in.n;
 
 	Rcpp::IntegerVector lane(l);
 	Rcpp::IntegerVector tile(l);
@@ -157,34 +112,20 @@ Rcpp::List readQualityMetrics(CharacterVector f) {
 	Rcpp::IntegerMatrix nclust(l,50);
 
 	/*
-	 * read input and feed the output structure
+	 * decode the records: every thread fills its own slice of the output vectors
 	 */
-	// open input file handle
-	FILE *file = NULL;
-	if ((file = fopen(fx.c_str(), "rb")) == NULL) {
-		stop("Could not open specified file");
-	}
-
-	// read version and register length
-	int r;
-	r = fread(&version, 1, 1, file);
-	r = fread(&length, 1, 1, file);
-
-	// loop over the registers
-	int i,j = 0;
-	while(!feof(file)) {
-		r = fread(&reg, sizeof(reg), 1, file);
-		lane[i]  = reg.lane;
-		tile[i]  = reg.tile;
-		cycle[i] = reg.cycle;
-		for(j=0; j<50; j++) {
-			nclust(i,j) = reg.nclust[j];
+	int    *lane_   = lane.begin();
+	int    *tile_   = tile.begin();
+	int    *cycle_  = cycle.begin();
+	int    *nclust_ = nclust.begin();
+	decodeRecords<QualityMetrics>(in, [&](int i, const QualityMetrics& reg) {
+		lane_[i]  = reg.lane;
+		tile_[i]  = reg.tile;
+		cycle_[i] = reg.cycle;
+		for(int j=0; j<50; j++) {
+			nclust_[i + j * l] = reg.nclust[j];
 		}
-		i++;
-	}
-	
-	// close the file and return the data frame
-	fclose(file);
+	});
 
 	Rcpp::DataFrame df = Rcpp::DataFrame::create(
 		Rcpp::Named("lane")  = lane,
@@ -209,36 +150,14 @@ Rcpp::DataFrame readErrorMetrics(CharacterVector f) {
 	std::string fx = as<std::string>(f[0]);
 	
 	/*
-	 * register definition
+	 * register definition: ErrorMetrics in InterOpRecords.h
 	 */
-	typedef unsigned char BYTE;
-	BYTE version;	// byte 0: file version number (3)
-	BYTE length;	// byte 1: length of each record
-	// bytes (N * 30 + 2) - (N * 30 + 31): record: (N is the record index)
-	#pragma pack(push, 1)
-	struct ErrorMetrics {
-		uint16_t lane;	// 2 bytes: lane number
-		uint16_t tile;	// 2 bytes: tile number
-		uint16_t cycle;	// 2 bytes: cycle number
-		//unsigned char padding[2];		// here the struct should be padded, but the file is not
-		float    erate;	// 4 bytes: error rate
-		uint32_t n;		// 4 bytes: number of perfect reads
-		uint32_t n1e;	// 4 bytes: number of reads with 1 error
-		uint32_t n2e;	// 4 bytes: number of reads with 2 errors
-		uint32_t n3e;	// 4 bytes: number of reads with 3 errors
-		uint32_t n4e;	// 4 bytes: number of reads with 4 errors
-		};
-	#pragma pack(pop)
-	ErrorMetrics reg;
 	
 	/*
 	 * output data structures: vectors that will be put together into a df
 	*/
-	struct stat st;
-	if(stat(fx.c_str(), &st) != 0) {
-		stop("Could not open specified file");
-	}
-	int l = (st.st_size - 2) / sizeof(reg) + 1;
+	RecordFile in(fx, sizeof(ErrorMetrics));
+	int l = in.n;
 
 	Rcpp::IntegerVector lane(l);
 	Rcpp::IntegerVector tile(l);
@@ -251,37 +170,28 @@ Rcpp::DataFrame readErrorMetrics(CharacterVector f) {
 	Rcpp::IntegerVector n4e(l);
 
 	/*
-	 * read input and feed the output structure
+	 * decode the records: every thread fills its own slice of the output vectors
 	 */
-	// open input file handle
-	FILE *file = NULL;
-	if ((file = fopen(fx.c_str(), "rb")) == NULL) {
-		stop("Could not open specified file");
-	}
-
-	// read version and register length
-	int r;
-	r = fread(&version, 1, 1, file);
-	r = fread(&length, 1, 1, file);
-
-	// loop over the registers
-	int i = 0;
-	while(!feof(file)) {
-		r = fread(&reg, sizeof(reg), 1, file);
-		lane[i]  = reg.lane;
-		tile[i]  = reg.tile;
-		cycle[i] = reg.cycle;
-		erate[i] = reg.erate;
-		n[i]     = reg.n;
-		n1e[i]   = reg.n1e;
-		n2e[i]   = reg.n2e;
-		n3e[i]   = reg.n3e;
-		n4e[i]   = reg.n4e;
-		i++;
-	}
-	
-	// close the file and return the data frame
-	fclose(file);
+	int    *lane_  = lane.begin();
+	int    *tile_  = tile.begin();
+	int    *cycle_ = cycle.begin();
+	double *erate_ = erate.begin();
+	int    *n_     = n.begin();
+	int    *n1e_   = n1e.begin();
+	int    *n2e_   = n2e.begin();
+	int    *n3e_   = n3e.begin();
+	int    *n4e_   = n4e.begin();
+	decodeRecords<ErrorMetrics>(in, [&](int i, const ErrorMetrics& reg) {
+		lane_[i]  = reg.lane;
+		tile_[i]  = reg.tile;
+		cycle_[i] = reg.cycle;
+		erate_[i] = reg.erate;
+		n_[i]     = reg.n;
+		n1e_[i]   = reg.n1e;
+		n2e_[i]   = reg.n2e;
+		n3e_[i]   = reg.n3e;
+		n4e_[i]   = reg.n4e;
+	});
 
 	Rcpp::DataFrame df = Rcpp::DataFrame::create(
 		Rcpp::Named("lane") = lane,
@@ -308,39 +218,14 @@ Rcpp::DataFrame readTileMetrics(CharacterVector f) {
 	std::string fx = as<std::string>(f[0]);
 	
 	/*
-	 * register definition
+	 * register definition: TileMetrics in InterOpRecords.h
 	 */
-	typedef unsigned char BYTE;
-	BYTE version;	// byte 0: file version number (3)
-	BYTE length;	// byte 1: length of each record
-	// bytes (N * 10 + 2) - (N * 10 + 11): record: (N is the record index)
-	#pragma pack(push, 1)
-	struct TileMetrics {
-		uint16_t lane;	// 2 bytes: lane number
-		uint16_t tile;	// 2 bytes: tile number
-		uint16_t code;	// 2 bytes: metric code
-		float    value;	// 4 bytes: metric value
-		};
-	/* possible metric codes are:
-	 * code 100: cluster density (k/mm2)
-	 * code 101: cluster density passing filters (k/mm2)
-	 * code 102: number of clusters
-	 * code 103: number of clusters passing filters
-	 * code (200 + (N – 1) * 2): phasing for read N
-	 * code (201 + (N – 1) * 2): prephasing for read N
-	 * code (300 + N – 1): percent aligned for read N
-	 * code 400: control lane */
- 	#pragma pack(pop)
- 	TileMetrics reg;
 	
 	/*
 	 * output data structures: vectors that will be put together into a df
 	 */
-	struct stat st;
-	if(stat(fx.c_str(), &st) != 0) {
-		stop("Could not open specified file");
-	}
-	int l = (st.st_size - 2) / sizeof(reg) + 1;
+	RecordFile in(fx, sizeof(TileMetrics));
+	int l = in.n;
 
 	Rcpp::IntegerVector lane(l);
 	Rcpp::IntegerVector tile(l);
@@ -348,32 +233,18 @@ Rcpp::DataFrame readTileMetrics(CharacterVector f) {
 	Rcpp::NumericVector value(l);
 
 	/*
-	 * read input and feed the output structure
+	 * decode the records: every thread fills its own slice of the output vectors
 	 */
-	// open input file handle
-	FILE *file = NULL;
-	if ((file = fopen(fx.c_str(), "rb")) == NULL) {
-		stop("Could not open specified file");
-	}
-
-	// read version and register length
-	int r;
-	r = fread(&version, 1, 1, file);
-	r = fread(&length, 1, 1, file);
-
-	// loop over the registers
-	int i = 0;
-	while(!feof(file)) {
-		r = fread(&reg, sizeof(reg), 1, file);
-		lane[i]  = reg.lane;
-		tile[i]  = reg.tile;
-		code[i]  = reg.code;
-		value[i] = reg.value;
-		i++;
-	}
-	
-	// close the file and return the data frame
-	fclose(file);
+	int    *lane_  = lane.begin();
+	int    *tile_  = tile.begin();
+	int    *code_  = code.begin();
+	double *value_ = value.begin();
+	decodeRecords<TileMetrics>(in, [&](int i, const TileMetrics& reg) {
+		lane_[i]  = reg.lane;
+		tile_[i]  = reg.tile;
+		code_[i]  = reg.code;
+		value_[i] = reg.value;
+	});
 
 	Rcpp::DataFrame df = Rcpp::DataFrame::create(
 		Rcpp::Named("lane") = lane,
@@ -395,44 +266,14 @@ Rcpp::DataFrame readCorrectedIntMetrics(CharacterVector f) {
 	std::string fx = as<std::string>(f[0]);
 	
 	/*
-	 * register definition
+	 * register definition: CorrectedIntMetrics in InterOpRecords.h
 	 */
-	typedef unsigned char BYTE;
-	BYTE version;	// byte 0: file version number (3)
-	BYTE length;	// byte 1: length of each record
-	// bytes (N * 48 + 2) - (N * 48 + 49): record: (N is the record index)
-	#pragma pack(push, 1)
-	struct CorrectedIntMetrics {
-		uint16_t lane;			// 2 bytes: lane number
-		uint16_t tile;      	// 2 bytes: tile number
-		uint16_t cycle;     	// 2 bytes: cycle number
-		uint16_t avgint;    	// 2 bytes: average intensity
-		uint16_t avgintA;   	// 2 bytes: average corrected int for channel A
-		uint16_t avgintC;   	// 2 bytes: average corrected int for channel C
-		uint16_t avgintG;   	// 2 bytes: average corrected int for channel G
-		uint16_t avgintT;   	// 2 bytes: average corrected int for channel T
-		uint16_t avgintclA; 	// 2 bytes: average corrected int for called clusters for base A
-		uint16_t avgintclC; 	// 2 bytes: average corrected int for called clusters for base C
-		uint16_t avgintclG; 	// 2 bytes: average corrected int for called clusters for base G
-		uint16_t avgintclT; 	// 2 bytes: average corrected int for called clusters for base T
-		float    bcNC;      	// 4 bytes: number of base calls for No Call
-		float    bcA;       	// 4 bytes: number of base calls for channel A
-		float    bcC;       	// 4 bytes: number of base calls for channel C
-		float    bcG;       	// 4 bytes: number of base calls for channel G
-		float    bcT;       	// 4 bytes: number of base calls for channel T
-		float    srratio;   	// 4 bytes: signal to noise ratio
-		};
-	#pragma pack(pop)
-	CorrectedIntMetrics reg;
 	
 	/*
 	 * output data structures: vectors that will be put together into a df
 	 */
-	struct stat st;
-	if(stat(fx.c_str(), &st) != 0) {
-		stop("Could not open specified file");
-	}
-	int l = (st.st_size - 2) / sizeof(reg) + 1;
+	RecordFile in(fx, sizeof(CorrectedIntMetrics));
+	int l = in.n;
 
 	Rcpp::IntegerVector lane(l);	   
 	Rcpp::IntegerVector tile(l);     
@@ -454,46 +295,46 @@ Rcpp::DataFrame readCorrectedIntMetrics(CharacterVector f) {
 	Rcpp::NumericVector srratio(l);  
 
 	/*
-	 * read input and feed the output structure
+	 * decode the records: every thread fills its own slice of the output vectors
 	 */
-	// open input file handle
-	FILE *file = NULL;
-	if ((file = fopen(fx.c_str(), "rb")) == NULL) {
-		stop("Could not open specified file");
-	}
-
-	// read version and register length
-	int r;
-	r = fread(&version, 1, 1, file);
-	r = fread(&length, 1, 1, file);
-
-	// loop over the registers
-	int i = 0;
-	while(!feof(file)) {
-		r = fread(&reg, sizeof(reg), 1, file);
-		lane[i]     = reg.lane;
-		tile[i]     = reg.tile;
-		cycle[i]    = reg.cycle;
-		avgint[i]   = reg.avgint;
-		avgintA[i]  = reg.avgintA;
-		avgintC[i]  = reg.avgintC;
-		avgintG[i]  = reg.avgintG;
-		avgintT[i]  = reg.avgintT;
-		avgintclA[i]= reg.avgintclA;
-		avgintclC[i]= reg.avgintclC;
-		avgintclG[i]= reg.avgintclG;
-		avgintclT[i]= reg.avgintclT;
-		bcNC[i]     = reg.bcNC;
-		bcA[i]      = reg.bcA;
-		bcC[i]      = reg.bcC;
-		bcG[i]      = reg.bcG;
-		bcT[i]      = reg.bcT;
-		srratio[i]  = reg.srratio;
-		i++;
-	}
-	
-	// close the file and return the data frame
-	fclose(file);
+	int    *lane_      = lane.begin();
+	int    *tile_      = tile.begin();
+	int    *cycle_     = cycle.begin();
+	int    *avgint_    = avgint.begin();
+	int    *avgintA_   = avgintA.begin();
+	int    *avgintC_   = avgintC.begin();
+	int    *avgintG_   = avgintG.begin();
+	int    *avgintT_   = avgintT.begin();
+	int    *avgintclA_ = avgintclA.begin();
+	int    *avgintclC_ = avgintclC.begin();
+	int    *avgintclG_ = avgintclG.begin();
+	int    *avgintclT_ = avgintclT.begin();
+	double *bcNC_      = bcNC.begin();
+	double *bcA_       = bcA.begin();
+	double *bcC_       = bcC.begin();
+	double *bcG_       = bcG.begin();
+	double *bcT_       = bcT.begin();
+	double *srratio_   = srratio.begin();
+	decodeRecords<CorrectedIntMetrics>(in, [&](int i, const CorrectedIntMetrics& reg) {
+		lane_[i]      = reg.lane;
+		tile_[i]      = reg.tile;
+		cycle_[i]     = reg.cycle;
+		avgint_[i]    = reg.avgint;
+		avgintA_[i]   = reg.avgintA;
+		avgintC_[i]   = reg.avgintC;
+		avgintG_[i]   = reg.avgintG;
+		avgintT_[i]   = reg.avgintT;
+		avgintclA_[i] = reg.avgintclA;
+		avgintclC_[i] = reg.avgintclC;
+		avgintclG_[i] = reg.avgintclG;
+		avgintclT_[i] = reg.avgintclT;
+		bcNC_[i]      = reg.bcNC;
+		bcA_[i]       = reg.bcA;
+		bcC_[i]       = reg.bcC;
+		bcG_[i]       = reg.bcG;
+		bcT_[i]       = reg.bcT;
+		srratio_[i]   = reg.srratio;
+	});
 
 	Rcpp::DataFrame df = Rcpp::DataFrame::create(
 		Rcpp::Named("lane")      = lane,
@@ -636,32 +477,14 @@ Rcpp::DataFrame readImageMetrics(CharacterVector f) {
 	std::string fx = as<std::string>(f[0]);
 	
 	/*
-	 * register definition
+	 * register definition: ImageMetrics in InterOpRecords.h
 	 */
-	typedef unsigned char BYTE;
-	BYTE version;	// byte 0: file version number (1)
-	BYTE length;	// byte 1: length of each record
-	// bytes (N * 12 + 2) - (N * 12 + 13): record: (N is the record index)
-	#pragma pack(push, 1)
-	struct ImageMetrics {
-		uint16_t lane;	// 2 bytes: lane number
-		uint16_t tile;	// 2 bytes: tile number
-		uint16_t cycle;	// 2 bytes: cycle number
-		uint16_t channelid;	// 2 bytes: channel id where 0=A, 1=C, 2=G, 3=T
-		uint16_t mincont;	// 2 bytes: min contrast value for image
-		uint16_t maxcont;	// 2 bytes: max contrast value for image
-		};
-	#pragma pack(pop)
-	ImageMetrics reg;
 	
 	/*
 	 * output data structures: vectors that will be put together into a df
 	*/
-	struct stat st;
-	if(stat(fx.c_str(), &st) != 0) {
-		stop("Could not open specified file");
-	}
-	int l = (st.st_size - 2) / sizeof(reg) + 1;
+	RecordFile in(fx, sizeof(ImageMetrics));
+	int l = in.n;
 
 	Rcpp::IntegerVector lane(l);
 	Rcpp::IntegerVector tile(l);
@@ -671,34 +494,22 @@ Rcpp::DataFrame readImageMetrics(CharacterVector f) {
 	Rcpp::IntegerVector maxcont(l);
 
 	/*
-	 * read input and feed the output structure
+	 * decode the records: every thread fills its own slice of the output vectors
 	 */
-	// open input file handle
-	FILE *file = NULL;
-	if ((file = fopen(fx.c_str(), "rb")) == NULL) {
-		stop("Could not open specified file");
-	}
-
-	// read version and register length
-	int r;
-	r = fread(&version, 1, 1, file);
-	r = fread(&length, 1, 1, file);
-
-	// loop over the registers
-	int i = 0;
-	while(!feof(file)) {
-		r = fread(&reg, sizeof(reg), 1, file);
-		lane[i]     = reg.lane;
-		tile[i]     = reg.tile;
-		cycle[i]    = reg.cycle;
-		channelid[i]= reg.channelid;
-		mincont[i]  = reg.mincont;
-		maxcont[i]  = reg.maxcont;
-		i++;
-	}
-	
-	// close the file and return the data frame
-	fclose(file);
+	int    *lane_      = lane.begin();
+	int    *tile_      = tile.begin();
+	int    *cycle_     = cycle.begin();
+	int    *channelid_ = channelid.begin();
+	int    *mincont_   = mincont.begin();
+	int    *maxcont_   = maxcont.begin();
+	decodeRecords<ImageMetrics>(in, [&](int i, const ImageMetrics& reg) {
+		lane_[i]      = reg.lane;
+		tile_[i]      = reg.tile;
+		cycle_[i]     = reg.cycle;
+		channelid_[i] = reg.channelid;
+		mincont_[i]   = reg.mincont;
+		maxcont_[i]   = reg.maxcont;
+	});
 
 	Rcpp::DataFrame df = Rcpp::DataFrame::create(
 		Rcpp::Named("lane")     = lane,
@@ -0,0 +1,447 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+#include <Rcpp.h>
+#include "RecordFile.h"
+#include "InterOpRecords.h"
+using namespace Rcpp;
+
+/***************************************
+ *
+ * Arrow C Data Interface export
+ *
+ * Every metric file is exported as a struct array (a record batch) whose
+ * columns keep the width they have on disk: uint16 keys, float32 fwhm, error
+ * rates and base calls, uint32 cluster counts. The records are split into one
+ * buffer per column in a single pass and handed over to the consumer, who
+ * frees them through the release callbacks, so arrow, duckdb or polars use
+ * the buffers as they are.
+ *
+ * https://arrow.apache.org/docs/format/CDataInterface.html
+ *
+ ***************************************/
+#ifndef ARROW_C_DATA_INTERFACE
+#define ARROW_C_DATA_INTERFACE
+
+#define ARROW_FLAG_DICTIONARY_ORDERED 1
+#define ARROW_FLAG_NULLABLE 2
+#define ARROW_FLAG_MAP_KEYS_SORTED 4
+
+struct ArrowSchema {
+	const char *format;
+	const char *name;
+	const char *metadata;
+	int64_t flags;
+	int64_t n_children;
+	struct ArrowSchema **children;
+	struct ArrowSchema *dictionary;
+	void (*release)(struct ArrowSchema *);
+	void *private_data;
+};
+
+struct ArrowArray {
+	int64_t length;
+	int64_t null_count;
+	int64_t offset;
+	int64_t n_buffers;
+	int64_t n_children;
+	const void **buffers;
+	struct ArrowArray **children;
+	struct ArrowArray *dictionary;
+	void (*release)(struct ArrowArray *);
+	void *private_data;
+};
+
+#endif
+
+/***************************************
+ *
+ * record layouts: name, arrow format, offset and width in the record,
+ * taken from the register definitions in InterOpRecords.h
+ *
+ ***************************************/
+enum FieldKind {
+	PLAIN,			// copied as it is
+	DOTNET_TIME,	// .Net ticks with 2 flag bits -> microseconds since 1970
+	FIXED_LIST		// width / item width consecutive items (item format in list)
+};
+
+struct Field {
+	const char *name;
+	const char *format;
+	int offset;
+	int width;
+	FieldKind kind;
+	const char *list;
+};
+
+struct Layout {
+	const char *table;
+	int size;	// record length
+	std::vector<Field> fields;
+};
+
+// a field of the register definition R (InterOpRecords.h)
+#define FIELD(R, m, format)       { #m, format, (int)offsetof(R, m), (int)sizeof(((R *)0)->m), PLAIN, NULL }
+#define KIND(R, m, format, k, l)  { #m, format, (int)offsetof(R, m), (int)sizeof(((R *)0)->m), k, l }
+
+static const std::vector<Layout>& layouts() {
+	static const std::vector<Layout> l = {
+		{ "extraction_metrics", sizeof(ExtractionMetrics), {
+			FIELD(ExtractionMetrics, lane, "S"), FIELD(ExtractionMetrics, tile, "S"), FIELD(ExtractionMetrics, cycle, "S"),
+			FIELD(ExtractionMetrics, fwhmA, "f"), FIELD(ExtractionMetrics, fwhmC, "f"), FIELD(ExtractionMetrics, fwhmG, "f"), FIELD(ExtractionMetrics, fwhmT, "f"),
+			FIELD(ExtractionMetrics, intA, "S"), FIELD(ExtractionMetrics, intC, "S"), FIELD(ExtractionMetrics, intG, "S"), FIELD(ExtractionMetrics, intT, "S"),
+			KIND(ExtractionMetrics, datetime, "tsu:", DOTNET_TIME, NULL) } },
+		{ "quality_metrics", sizeof(QualityMetrics), {
+			FIELD(QualityMetrics, lane, "S"), FIELD(QualityMetrics, tile, "S"), FIELD(QualityMetrics, cycle, "S"),
+			KIND(QualityMetrics, nclust, "+w:50", FIXED_LIST, "I") } },
+		{ "error_metrics", sizeof(ErrorMetrics), {
+			FIELD(ErrorMetrics, lane, "S"), FIELD(ErrorMetrics, tile, "S"), FIELD(ErrorMetrics, cycle, "S"),
+			FIELD(ErrorMetrics, erate, "f"),
+			FIELD(ErrorMetrics, n, "I"), FIELD(ErrorMetrics, n1e, "I"), FIELD(ErrorMetrics, n2e, "I"),
+			FIELD(ErrorMetrics, n3e, "I"), FIELD(ErrorMetrics, n4e, "I") } },
+		{ "tile_metrics", sizeof(TileMetrics), {
+			FIELD(TileMetrics, lane, "S"), FIELD(TileMetrics, tile, "S"), FIELD(TileMetrics, code, "S"),
+			FIELD(TileMetrics, value, "f") } },
+		{ "corrected_int_metrics", sizeof(CorrectedIntMetrics), {
+			FIELD(CorrectedIntMetrics, lane, "S"), FIELD(CorrectedIntMetrics, tile, "S"), FIELD(CorrectedIntMetrics, cycle, "S"),
+			FIELD(CorrectedIntMetrics, avgint, "S"),
+			FIELD(CorrectedIntMetrics, avgintA, "S"), FIELD(CorrectedIntMetrics, avgintC, "S"), FIELD(CorrectedIntMetrics, avgintG, "S"), FIELD(CorrectedIntMetrics, avgintT, "S"),
+			FIELD(CorrectedIntMetrics, avgintclA, "S"), FIELD(CorrectedIntMetrics, avgintclC, "S"), FIELD(CorrectedIntMetrics, avgintclG, "S"), FIELD(CorrectedIntMetrics, avgintclT, "S"),
+			FIELD(CorrectedIntMetrics, bcNC, "f"), FIELD(CorrectedIntMetrics, bcA, "f"), FIELD(CorrectedIntMetrics, bcC, "f"),
+			FIELD(CorrectedIntMetrics, bcG, "f"), FIELD(CorrectedIntMetrics, bcT, "f"), FIELD(CorrectedIntMetrics, srratio, "f") } },
+		{ "image_metrics", sizeof(ImageMetrics), {
+			FIELD(ImageMetrics, lane, "S"), FIELD(ImageMetrics, tile, "S"), FIELD(ImageMetrics, cycle, "S"),
+			FIELD(ImageMetrics, channelid, "S"), FIELD(ImageMetrics, mincont, "S"), FIELD(ImageMetrics, maxcont, "S") } }
+	};
+	return l;
+}
+
+#undef FIELD
+#undef KIND
+
+/***************************************
+ *
+ * exported structures own their buffers through private_data. Children can be
+ * moved out and released on their own, so each one owns its buffers too
+ *
+ ***************************************/
+struct ArrayData {
+	std::vector<void *> buffers;	// NULL for the (absent) validity bitmaps
+	std::vector<ArrowArray *> children;
+};
+
+static void releaseArray(ArrowArray *a) {
+	ArrayData *d = (ArrayData *)a->private_data;
+	for(size_t i=0; i < d->children.size(); i++) {
+		if(d->children[i]->release) d->children[i]->release(d->children[i]);
+		delete d->children[i];
+	}
+	for(size_t i=0; i < d->buffers.size(); i++) free(d->buffers[i]);
+	delete[] a->buffers;
+	delete[] a->children;
+	delete d;
+	a->release = NULL;
+}
+
+static void *allocBuffer(size_t bytes) {
+	void *p = NULL;
+	if(posix_memalign(&p, 64, bytes ? bytes : 1) != 0) throw std::bad_alloc();
+	return p;
+}
+
+// fill a with length rows, the given buffers and children. It takes their
+// ownership only if it returns: when an allocation throws, a is left untouched
+static void initArray(ArrowArray *a, int64_t length, const std::vector<void *>& buffers, const std::vector<ArrowArray *>& children) {
+	std::unique_ptr<ArrayData> d(new ArrayData);
+	std::unique_ptr<const void *[]> b(new const void *[buffers.size()]);
+	std::unique_ptr<ArrowArray *[]> c(children.empty() ? NULL : new ArrowArray *[children.size()]);
+	d->buffers  = buffers;
+	d->children = children;
+	for(size_t i=0; i < buffers.size(); i++)  b[i] = buffers[i];
+	for(size_t i=0; i < children.size(); i++) c[i] = children[i];
+	a->length     = length;
+	a->null_count = 0;
+	a->offset     = 0;
+	a->n_buffers  = buffers.size();
+	a->n_children = children.size();
+	a->buffers    = b.release();
+	a->children   = c.release();
+	a->dictionary   = NULL;
+	a->release      = releaseArray;
+	a->private_data = d.release();
+}
+
+struct SchemaData {
+	std::string format, name;
+	std::vector<ArrowSchema *> children;
+};
+
+static void releaseSchema(ArrowSchema *s) {
+	SchemaData *d = (SchemaData *)s->private_data;
+	for(size_t i=0; i < d->children.size(); i++) {
+		if(d->children[i]->release) d->children[i]->release(d->children[i]);
+		delete d->children[i];
+	}
+	delete[] s->children;
+	delete d;
+	s->release = NULL;
+}
+
+// same ownership rules as initArray
+static void initSchema(ArrowSchema *s, const std::string& format, const std::string& name, const std::vector<ArrowSchema *>& children) {
+	std::unique_ptr<SchemaData> d(new SchemaData);
+	std::unique_ptr<ArrowSchema *[]> c(children.empty() ? NULL : new ArrowSchema *[children.size()]);
+	d->format   = format;
+	d->name     = name;
+	d->children = children;
+	for(size_t i=0; i < children.size(); i++) c[i] = children[i];
+	s->format     = d->format.c_str();
+	s->name       = d->name.c_str();
+	s->metadata   = NULL;
+	s->flags      = 0;	// no nulls
+	s->n_children = children.size();
+	s->children   = c.release();
+	s->dictionary   = NULL;
+	s->release      = releaseSchema;
+	s->private_data = d.release();
+}
+
+/*
+ * owner of everything an export allocates (buffers, child arrays and
+ * schemas) until a parent takes it over, so nothing leaks when an
+ * allocation throws half way
+ */
+class Pending {
+public:
+	~Pending() {
+		for(size_t i=0; i < buffers.size(); i++) free(buffers[i]);
+		for(size_t i=0; i < arrays.size(); i++) {
+			if(arrays[i]->release) arrays[i]->release(arrays[i]);
+			delete arrays[i];
+		}
+		for(size_t i=0; i < schemas.size(); i++) {
+			if(schemas[i]->release) schemas[i]->release(schemas[i]);
+			delete schemas[i];
+		}
+	}
+
+	void *buffer(size_t bytes) {
+		buffers.reserve(buffers.size() + 1);
+		void *b = allocBuffer(bytes);
+		buffers.push_back(b);
+		return b;
+	}
+
+	// child array owning the given buffers and children
+	ArrowArray *array(int64_t length, const std::vector<void *>& b, const std::vector<ArrowArray *>& children = std::vector<ArrowArray *>()) {
+		arrays.reserve(arrays.size() + 1);
+		ArrowArray *a = new ArrowArray;
+		a->release = NULL;
+		arrays.push_back(a);
+		initArray(a, length, b, children);
+		taken(b, children);
+		return a;
+	}
+
+	ArrowSchema *schema(const std::string& format, const std::string& name, const std::vector<ArrowSchema *>& children = std::vector<ArrowSchema *>()) {
+		schemas.reserve(schemas.size() + 1);
+		ArrowSchema *s = new ArrowSchema;
+		s->release = NULL;
+		schemas.push_back(s);
+		initSchema(s, format, name, children);
+		taken(children);
+		return s;
+	}
+
+	// the caller's struct array and schema take the top level columns
+	void finish(ArrowArray *array, ArrowSchema *schema, int64_t length, const std::vector<ArrowArray *>& children, const std::vector<ArrowSchema *>& fields) {
+		initSchema(schema, "+s", "", fields);
+		taken(fields);
+		try {
+			initArray(array, length, std::vector<void *>(1), children);
+		} catch(...) {
+			schema->release(schema);
+			throw;
+		}
+		taken(std::vector<void *>(), children);
+	}
+
+private:
+	std::vector<void *> buffers;
+	std::vector<ArrowArray *> arrays;
+	std::vector<ArrowSchema *> schemas;
+
+	template<typename T>
+	static void forget(std::vector<T>& v, const std::vector<T>& x) {
+		for(size_t i=0; i < x.size(); i++) v.erase(std::remove(v.begin(), v.end(), x[i]), v.end());
+	}
+	void taken(const std::vector<void *>& b, const std::vector<ArrowArray *>& children) { forget(buffers, b); forget(arrays, children); }
+	void taken(const std::vector<ArrowSchema *>& children) { forget(schemas, children); }
+};
+
+/***************************************
+ *
+ * fixed record length files: one pass over the records, every thread
+ * scattering its slice into the column buffers
+ *
+ ***************************************/
+static void exportRecords(const std::string& fx, const Layout& layout, ArrowArray *array, ArrowSchema *schema) {
+
+	RecordFile in(fx, layout.size);
+	int l = in.n;
+	size_t nf = layout.fields.size();
+
+	Pending pending;
+	std::vector<char *> col(nf);
+	for(size_t j=0; j < nf; j++) col[j] = (char *)pending.buffer((size_t)l * layout.fields[j].width);
+
+	forRecords(in, [&](int b, int e) {
+		for(int i=b; i < e; i++) {
+			const RecordFile::BYTE *rec = in.record(i);
+			for(size_t j=0; j < nf; j++) {
+				const Field& f = layout.fields[j];
+				char *dst = col[j] + (size_t)i * f.width;
+				memcpy(dst, rec + f.offset, f.width);
+				if(f.kind == DOTNET_TIME) {
+					int64_t t;
+					memcpy(&t, dst, 8);
+					t = ((t & 0x3FFFFFFFFFFFFFFF) - 621355968000000000LL) / 10;	// remove the flag bits, 100 nanosec ticks from 01-01-0001
+					memcpy(dst, &t, 8);
+				}
+			}
+		}
+	});
+
+	std::vector<ArrowArray *> children;
+	std::vector<ArrowSchema *> fields;
+	for(size_t j=0; j < nf; j++) {
+		const Field& f = layout.fields[j];
+		std::vector<void *> b(2);
+		b[1] = col[j];
+		if(f.kind == FIXED_LIST) {	// the items are the ones in the column buffer, the list itself has no buffers
+			int items = f.width / 4;
+			ArrowArray *item = pending.array((int64_t)l * items, b);
+			children.push_back(pending.array(l, std::vector<void *>(1), std::vector<ArrowArray *>(1, item)));
+			fields.push_back(pending.schema(f.format, f.name, std::vector<ArrowSchema *>(1, pending.schema(f.list, "item"))));
+		} else {
+			children.push_back(pending.array(l, b));
+			fields.push_back(pending.schema(f.format, f.name));
+		}
+	}
+
+	pending.finish(array, schema, l, children, fields);
+}
+
+/***************************************
+ *
+ * control metrics: variable length records
+ *   lane, tile, read: 2 bytes each
+ *   2 bytes control name length X, X bytes control name
+ *   2 bytes index name length Y, Y bytes index name
+ *   4 bytes number of clusters identified as control
+ *
+ ***************************************/
+static void exportControlMetrics(const std::string& fx, ArrowArray *array, ArrowSchema *schema) {
+
+	FILE *file = fopen(fx.c_str(), "rb");
+	if(file == NULL) stop("Could not open specified file");
+	std::vector<unsigned char> data;
+	unsigned char buf[1 << 16];
+	for(size_t r; (r = fread(buf, 1, sizeof(buf), file)) > 0; ) data.insert(data.end(), buf, buf + r);
+	fclose(file);
+
+	std::vector<uint16_t> lane, tile, read;
+	std::vector<int32_t> controlOffsets(1, 0), indexOffsets(1, 0);
+	std::string control, index;
+	std::vector<uint32_t> nclust;
+
+	size_t p = 1;	// skip the version
+	uint16_t u16;
+	uint32_t u32;
+	while(p + 8 <= data.size()) {
+		memcpy(&u16, &data[p], 2); lane.push_back(u16);
+		memcpy(&u16, &data[p + 2], 2); tile.push_back(u16);
+		memcpy(&u16, &data[p + 4], 2); read.push_back(u16);
+		memcpy(&u16, &data[p + 6], 2); p += 8;
+		if(p + u16 + 2 > data.size()) break;
+		control.append((const char *)&data[p], u16); p += u16;
+		memcpy(&u16, &data[p], 2); p += 2;
+		if(p + u16 + 4 > data.size()) break;
+		index.append((const char *)&data[p], u16); p += u16;
+		memcpy(&u32, &data[p], 4); p += 4;
+		nclust.push_back(u32);
+		controlOffsets.push_back(control.size());
+		indexOffsets.push_back(index.size());
+	}
+	int l = nclust.size();
+
+	// copy into buffers owned by the arrays
+	Pending pending;
+	auto buffer = [&](const void *x, size_t bytes) {
+		void *b = pending.buffer(bytes);
+		memcpy(b, x, bytes);
+		return b;
+	};
+	auto column = [&](std::vector<void *> b) {
+		return pending.array(l, b);
+	};
+	std::vector<ArrowArray *> children;
+	children.push_back(column({ NULL, buffer(lane.data(), l * 2) }));
+	children.push_back(column({ NULL, buffer(tile.data(), l * 2) }));
+	children.push_back(column({ NULL, buffer(read.data(), l * 2) }));
+	children.push_back(column({ NULL, buffer(controlOffsets.data(), (l + 1) * 4), buffer(control.data(), control.size()) }));
+	children.push_back(column({ NULL, buffer(indexOffsets.data(), (l + 1) * 4), buffer(index.data(), index.size()) }));
+	children.push_back(column({ NULL, buffer(nclust.data(), l * 4) }));
+
+	std::vector<ArrowSchema *> fields;
+	fields.push_back(pending.schema("S", "lane"));
+	fields.push_back(pending.schema("S", "tile"));
+	fields.push_back(pending.schema("S", "read"));
+	fields.push_back(pending.schema("u", "control"));
+	fields.push_back(pending.schema("u", "index"));
+	fields.push_back(pending.schema("I", "nclust"));
+
+	pending.finish(array, schema, l, children, fields);
+}
+
+/***************************************
+ *
+ * R interface: array and schema are caller allocated structures, given as
+ * external pointers (eg. nanoarrow_allocate_array()). They must be empty
+ * (released), so nothing they hold is overwritten
+ *
+ ***************************************/
+static void *address(SEXP x) {
+	if(TYPEOF(x) != EXTPTRSXP) stop("Expected an external pointer to an Arrow structure");
+	return R_ExternalPtrAddr(x);
+}
+
+// [[Rcpp::export]]
+void exportInterOpArrow(CharacterVector f, std::string table, SEXP array, SEXP schema) {
+
+	std::string fx = as<std::string>(f[0]);
+	ArrowArray  *a = (ArrowArray *)address(array);
+	ArrowSchema *s = (ArrowSchema *)address(schema);
+	if(a == NULL || s == NULL) stop("NULL array or schema");
+	if(a->release != NULL || s->release != NULL) stop("The array or schema already holds data: release it first");
+
+	if(table == "control_metrics") {
+		exportControlMetrics(fx, a, s);
+		return;
+	}
+	const std::vector<Layout>& l = layouts();
+	for(size_t i=0; i < l.size(); i++) {
+		if(table == l[i].table) {
+			exportRecords(fx, l[i], a, s);
+			return;
+		}
+	}
+	stop("Unknown metrics table: " + table);
+}
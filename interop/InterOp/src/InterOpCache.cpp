@@ -0,0 +1,737 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <algorithm>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include <Rcpp.h>
+#include <R_ext/Altrep.h>
+#include <R_ext/Rdynload.h>
+using namespace Rcpp;
+
+/***************************************
+ *
+ * Shared memory run cache
+ *
+ * A server process decodes every run once and publishes its tables in a
+ * POSIX shared memory segment. Workers (eg. Shiny processes) ask for a run
+ * through a unix socket and map the segment copy-on-write: the columns are
+ * ALTREP vectors pointing into the mapping, so the data lives in memory once
+ * per host. The server counts the references of every connection, releases
+ * them when the worker lets the vectors go (or dies), and evicts the least
+ * recently used unreferenced runs once the cache grows beyond its budget.
+ *
+ * protocol (one line per message):
+ *   worker -> server: GET <run folder>      server -> worker: OK <segment> | ERR <message>
+ *   worker -> server: RELEASE <segment>
+ *
+ * The socket must be in a directory only the user can enter (mode 0700),
+ * and both ends check that the peer runs as the same user.
+ *
+ ***************************************/
+
+// readers in InterOp.cpp
+Rcpp::DataFrame readExtractionMetrics(CharacterVector f);
+Rcpp::List      readQualityMetrics(CharacterVector f);
+Rcpp::DataFrame readErrorMetrics(CharacterVector f);
+Rcpp::DataFrame readTileMetrics(CharacterVector f);
+Rcpp::DataFrame readCorrectedIntMetrics(CharacterVector f);
+Rcpp::DataFrame readControlMetrics(CharacterVector f);
+Rcpp::DataFrame readImageMetrics(CharacterVector f);
+
+static const struct {
+	const char *table;
+	const char *file;
+	SEXP (*read)(CharacterVector);
+} RUN_FILES[] = {
+	{ "extraction_metrics",    "ExtractionMetricsOut.bin",   [](CharacterVector f) -> SEXP { return readExtractionMetrics(f); } },
+	{ "quality_metrics",       "QMetricsOut.bin",            [](CharacterVector f) -> SEXP { return readQualityMetrics(f); } },
+	{ "error_metrics",         "ErrorMetricsOut.bin",        [](CharacterVector f) -> SEXP { return readErrorMetrics(f); } },
+	{ "tile_metrics",          "TileMetricsOut.bin",         [](CharacterVector f) -> SEXP { return readTileMetrics(f); } },
+	{ "corrected_int_metrics", "CorrectedIntMetricsOut.bin", [](CharacterVector f) -> SEXP { return readCorrectedIntMetrics(f); } },
+	{ "control_metrics",       "ControlMetricsOut.bin",      [](CharacterVector f) -> SEXP { return readControlMetrics(f); } },
+	{ "image_metrics",         "ImageMetricsOut.bin",        [](CharacterVector f) -> SEXP { return readImageMetrics(f); } }
+};
+static const int N_RUN_FILES = sizeof(RUN_FILES) / sizeof(RUN_FILES[0]);
+
+/***************************************
+ *
+ * segment layout: a directory of tables and columns, then the column
+ * buffers (64 bytes aligned) in their native R representation
+ *
+ ***************************************/
+#define SEGMENT_MAGIC 0x43504F49	// "IOPC"
+#define ALIGN(x) (((x) + 63) & ~(uint64_t)63)
+
+struct SegmentHeader {
+	uint32_t magic;
+	uint32_t ntables;
+};
+struct TableHeader {
+	char     name[32];
+	uint32_t ncols;
+	uint32_t nrows;
+};
+struct ColumnHeader {
+	char     name[32];
+	uint32_t type;		// INTSXP, REALSXP or STRSXP (NUL terminated strings)
+	uint32_t ncol;		// number of columns if it's a matrix, 0 otherwise
+	uint64_t offset;	// from the start of the segment
+	uint64_t bytes;
+};
+
+/***************************************
+ *
+ * socket helpers
+ *
+ ***************************************/
+static bool sendLine(int fd, const std::string& s) {
+	std::string line = s + "\n";
+	for(size_t n=0; n < line.size(); ) {
+		ssize_t r = send(fd, line.data() + n, line.size() - n, MSG_NOSIGNAL);
+		if(r < 0 && errno == EINTR) continue;
+		if(r <= 0) return false;
+		n += r;
+	}
+	return true;
+}
+
+// split complete lines out of a connection buffer
+static bool nextLine(std::string& buf, std::string& line) {
+	size_t eol = buf.find('\n');
+	if(eol == std::string::npos) return false;
+	line = buf.substr(0, eol);
+	buf.erase(0, eol + 1);
+	return true;
+}
+
+// the peer of a unix socket must run as this same user
+static bool samePeer(int fd) {
+#ifdef SO_PEERCRED
+	struct ucred cred;
+	socklen_t len = sizeof(cred);
+	return getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &len) == 0 && cred.uid == getuid();
+#else
+	uid_t uid;
+	gid_t gid;
+	return getpeereid(fd, &uid, &gid) == 0 && uid == getuid();
+#endif
+}
+
+// the socket must live in a directory owned by this user and closed to everybody else
+static void checkPrivateDir(const std::string& socket) {
+	size_t slash = socket.rfind('/');
+	std::string dir = slash == std::string::npos ? "." : slash == 0 ? "/" : socket.substr(0, slash);
+	struct stat st;
+	if(lstat(dir.c_str(), &st) != 0 || !S_ISDIR(st.st_mode) || st.st_uid != getuid() || (st.st_mode & 077))
+		stop("The InterOp cache socket must be in a private directory (owned by you, mode 0700): " + dir);
+}
+
+static int unixSocket(const std::string& path, struct sockaddr_un& addr) {
+	if(path.size() >= sizeof(addr.sun_path)) stop("Socket path too long: " + path);
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, path.c_str());
+#ifdef SOCK_CLOEXEC
+	return socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+#else
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if(fd >= 0) fcntl(fd, F_SETFD, FD_CLOEXEC);
+	return fd;
+#endif
+}
+
+/***************************************
+ *
+ * server
+ *
+ ***************************************/
+struct CachedRun {
+	std::string segment;
+	std::string signature;	// size and mtime of the run files when decoded
+	uint64_t bytes;
+	int refs;
+	uint64_t used;			// LRU clock
+};
+
+struct Connection {
+	std::string buf;
+	std::multiset<std::string> segments;	// references held
+};
+
+class CacheServer {
+public:
+	CacheServer(const std::string& socket, double maxMB) :
+		socket(socket), maxBytes(maxMB * 1024 * 1024), total(0), clock(0), serial(0), listener(-1) {}
+
+	~CacheServer() {
+		for(std::map<std::string, CachedRun>::iterator r=runs.begin(); r != runs.end(); ++r) shm_unlink(r->second.segment.c_str());
+		for(std::map<int, Connection>::iterator c=conns.begin(); c != conns.end(); ++c) close(c->first);
+		if(listener >= 0) {
+			close(listener);
+			unlink(socket.c_str());
+		}
+	}
+
+	void serve() {
+
+		struct sockaddr_un addr;
+		checkPrivateDir(socket);
+		listener = unixSocket(socket, addr);
+		unlink(socket.c_str());
+		if(listener < 0 || bind(listener, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(listener, 64) != 0)
+			stop("Could not listen on " + socket);
+		chmod(socket.c_str(), 0600);
+
+		Rcout << "InterOp cache listening on " << socket << std::endl;
+		while(true) {
+			std::vector<struct pollfd> fds(1);
+			fds[0].fd = listener;
+			fds[0].events = POLLIN;
+			for(std::map<int, Connection>::iterator c=conns.begin(); c != conns.end(); ++c) {
+				struct pollfd p = { c->first, POLLIN, 0 };
+				fds.push_back(p);
+			}
+
+			if(poll(&fds[0], fds.size(), 500) > 0) {
+				if(fds[0].revents & POLLIN) {
+					int fd = accept(listener, NULL, NULL);
+					if(fd >= 0 && samePeer(fd)) conns[fd] = Connection();
+					else if(fd >= 0) close(fd);
+				}
+				for(size_t i=1; i < fds.size(); i++) {
+					if(fds[i].revents) receive(fds[i].fd);
+				}
+			}
+			checkUserInterrupt();	// Ctrl-C stops the server and unlinks the segments
+		}
+	}
+
+private:
+	std::string socket;
+	uint64_t maxBytes, total, clock;
+	int serial;
+	int listener;
+	std::map<std::string, CachedRun> runs;	// by run folder
+	std::map<int, Connection> conns;
+
+	void receive(int fd) {
+
+		char buf[4096];
+		ssize_t n = recv(fd, buf, sizeof(buf), 0);
+		if(n <= 0) {	// worker gone: drop its references
+			Connection& c = conns[fd];
+			for(std::multiset<std::string>::iterator s=c.segments.begin(); s != c.segments.end(); ++s) release(*s);
+			close(fd);
+			conns.erase(fd);
+			evict();
+			return;
+		}
+
+		Connection& c = conns[fd];
+		c.buf.append(buf, n);
+		std::string line;
+		while(nextLine(c.buf, line)) {
+			if(line.compare(0, 4, "GET ") == 0) {
+				std::string reply = get(line.substr(4));
+				if(reply.compare(0, 3, "OK ") == 0) c.segments.insert(reply.substr(3));
+				sendLine(fd, reply);
+			} else if(line.compare(0, 8, "RELEASE ") == 0) {
+				std::multiset<std::string>::iterator s = c.segments.find(line.substr(8));
+				if(s != c.segments.end()) {
+					release(*s);
+					c.segments.erase(s);
+					evict();
+				}
+			}
+		}
+	}
+
+	static std::string signature(const std::string& path) {
+		std::string sig;
+		for(int i=0; i < N_RUN_FILES; i++) {
+			struct stat st;
+			char x[64];
+			if(stat((path + "/" + RUN_FILES[i].file).c_str(), &st) != 0) return "";
+			snprintf(x, sizeof(x), "%lld.%lld;", (long long)st.st_size, (long long)st.st_mtime);
+			sig += x;
+		}
+		return sig;
+	}
+
+	std::string get(const std::string& folder) {
+
+		char real[PATH_MAX];
+		if(realpath(folder.c_str(), real) == NULL) return "ERR Could not open specified folder";
+		std::string path(real), sig = signature(path);
+
+		std::map<std::string, CachedRun>::iterator r = runs.find(path);
+		if(r != runs.end() && r->second.signature != sig) {	// run files changed: forget the old copy
+			shm_unlink(r->second.segment.c_str());
+			total -= r->second.bytes;
+			runs.erase(r);
+			r = runs.end();
+		}
+		if(r == runs.end()) {
+			CachedRun run;
+			try {
+				publish(path, run);
+			} catch(std::exception& e) {
+				return std::string("ERR ") + e.what();
+			}
+			run.signature = sig;
+			run.refs = 0;
+			r = runs.insert(std::make_pair(path, run)).first;
+			total += run.bytes;
+		}
+
+		r->second.refs++;
+		r->second.used = ++clock;
+		evict();
+		return "OK " + r->second.segment;
+	}
+
+	void release(const std::string& segment) {
+		for(std::map<std::string, CachedRun>::iterator r=runs.begin(); r != runs.end(); ++r) {
+			if(r->second.segment == segment) { r->second.refs--; return; }
+		}
+	}
+
+	// drop the least recently used runs nobody holds until the cache fits its budget.
+	// Workers still mapping an unlinked segment keep their copy until they unmap it
+	void evict() {
+		while(total > maxBytes) {
+			std::map<std::string, CachedRun>::iterator lru = runs.end();
+			for(std::map<std::string, CachedRun>::iterator r=runs.begin(); r != runs.end(); ++r) {
+				if(r->second.refs <= 0 && (lru == runs.end() || r->second.used < lru->second.used)) lru = r;
+			}
+			if(lru == runs.end()) return;
+			shm_unlink(lru->second.segment.c_str());
+			total -= lru->second.bytes;
+			runs.erase(lru);
+		}
+	}
+
+	/*
+	 * decode the run and copy the tables into a new segment
+	 */
+	struct Column { std::string name; SEXP x; uint32_t type, ncol; uint64_t bytes; };
+	struct Table  { std::string name; uint32_t nrows; std::vector<Column> cols; };
+
+	// the quality metrics come as list(key = df, nclust = matrix): flatten them
+	static void collect(Table& t, SEXP x, SEXP names) {
+		for(R_xlen_t i=0; i < Rf_xlength(x); i++) {
+			SEXP col = VECTOR_ELT(x, i);
+			if(TYPEOF(col) == VECSXP) {
+				collect(t, col, Rf_getAttrib(col, R_NamesSymbol));
+				continue;
+			}
+			Column c;
+			c.name = CHAR(STRING_ELT(names, i));
+			c.x    = col;
+			c.type = TYPEOF(col);
+			c.ncol = Rf_isMatrix(col) ? Rf_ncols(col) : 0;
+			if(c.type == INTSXP)       c.bytes = Rf_xlength(col) * sizeof(int);
+			else if(c.type == REALSXP) c.bytes = Rf_xlength(col) * sizeof(double);
+			else if(c.type == STRSXP) {
+				c.bytes = 0;
+				for(R_xlen_t j=0; j < Rf_xlength(col); j++) c.bytes += strlen(CHAR(STRING_ELT(col, j))) + 1;
+			} else stop("Unexpected column type in " + t.name);
+			if(!c.ncol) t.nrows = Rf_xlength(col);
+			t.cols.push_back(c);
+		}
+	}
+
+	void publish(const std::string& path, CachedRun& run) {
+
+		std::vector<Table> tables(N_RUN_FILES);
+		Rcpp::List keep(N_RUN_FILES);	// protect the decoded tables
+		uint64_t dir = sizeof(SegmentHeader), bytes = 0;
+		for(int i=0; i < N_RUN_FILES; i++) {
+			keep[i] = RUN_FILES[i].read(CharacterVector::create(path + "/" + RUN_FILES[i].file));
+			tables[i].name  = RUN_FILES[i].table;
+			tables[i].nrows = 0;
+			collect(tables[i], keep[i], Rf_getAttrib(keep[i], R_NamesSymbol));
+			dir += sizeof(TableHeader) + tables[i].cols.size() * sizeof(ColumnHeader);
+			for(size_t j=0; j < tables[i].cols.size(); j++) bytes += ALIGN(tables[i].cols[j].bytes);
+		}
+		bytes += ALIGN(dir);
+
+		char name[64];
+		snprintf(name, sizeof(name), "/InterOp.%d.%d", (int)getpid(), ++serial);
+		int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600);
+		if(fd < 0) stop("Could not create shared memory segment");
+		if(ftruncate(fd, bytes) != 0) {
+			close(fd);
+			shm_unlink(name);
+			stop("Could not allocate shared memory segment");
+		}
+		char *seg = (char *)mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		close(fd);
+		if(seg == MAP_FAILED) {
+			shm_unlink(name);
+			stop("Could not map shared memory segment");
+		}
+
+		SegmentHeader *h = (SegmentHeader *)seg;
+		h->magic   = SEGMENT_MAGIC;
+		h->ntables = N_RUN_FILES;
+		char *p = seg + sizeof(SegmentHeader);
+		uint64_t offset = ALIGN(dir);
+		for(int i=0; i < N_RUN_FILES; i++) {
+			TableHeader *th = (TableHeader *)p;
+			strncpy(th->name, tables[i].name.c_str(), sizeof(th->name) - 1);
+			th->ncols = tables[i].cols.size();
+			th->nrows = tables[i].nrows;
+			p += sizeof(TableHeader);
+
+			for(size_t j=0; j < tables[i].cols.size(); j++) {
+				const Column& c = tables[i].cols[j];
+				ColumnHeader *ch = (ColumnHeader *)p;
+				strncpy(ch->name, c.name.c_str(), sizeof(ch->name) - 1);
+				ch->type   = c.type;
+				ch->ncol   = c.ncol;
+				ch->offset = offset;
+				ch->bytes  = c.bytes;
+				p += sizeof(ColumnHeader);
+
+				if(c.type == INTSXP)       memcpy(seg + offset, INTEGER(c.x), c.bytes);
+				else if(c.type == REALSXP) memcpy(seg + offset, REAL(c.x), c.bytes);
+				else {
+					char *s = seg + offset;
+					for(R_xlen_t k=0; k < Rf_xlength(c.x); k++) {
+						strcpy(s, CHAR(STRING_ELT(c.x, k)));
+						s += strlen(s) + 1;
+					}
+				}
+				offset += ALIGN(c.bytes);
+			}
+		}
+		munmap(seg, bytes);
+
+		run.segment = name;
+		run.bytes   = bytes;
+	}
+};
+
+// [[Rcpp::export]]
+void runInterOpCacheServer(std::string socket, double maxMB) {
+	CacheServer server(socket, maxMB);
+	server.serve();
+}
+
+/***************************************
+ *
+ * worker: one connection per process, and one mapping per run shared by
+ * all its column vectors. When the last vector is garbage collected the
+ * segment is unmapped and released on the server.
+ * Forked children (mclapply, makeForkCluster...) inherit the connection and
+ * the mappings: they open their own connection, and never release the
+ * references the server counts for the parent
+ *
+ ***************************************/
+static int connection = -1;
+static pid_t connectionPid = -1;	// process that opened the connection
+static std::string connectionBuf;
+
+struct Mapping {
+	void  *addr;
+	size_t bytes;
+	std::string segment;
+	pid_t pid;	// process that sent the GET
+};
+
+static void finalizeMapping(SEXP ptr) {
+	Mapping *m = (Mapping *)R_ExternalPtrAddr(ptr);
+	if(m == NULL) return;
+	munmap(m->addr, m->bytes);
+	if(connection >= 0 && m->pid == getpid() && connectionPid == getpid()) sendLine(connection, "RELEASE " + m->segment);
+	delete m;
+	R_ClearExternalPtr(ptr);
+}
+
+static std::string request(const std::string& socket, const std::string& line) {
+
+	// inherited from the parent: drop this process' copy of the descriptor
+	// (close() without shutdown(), the parent's connection stays up)
+	if(connection >= 0 && connectionPid != getpid()) {
+		close(connection);
+		connection = -1;
+	}
+
+	// (re)connect if needed, eg. after a server restart
+	for(int attempt=0; attempt < 2; attempt++) {
+		if(connection < 0) {
+			struct sockaddr_un addr;
+			checkPrivateDir(socket);
+			connection = unixSocket(socket, addr);
+			if(connection < 0 || connect(connection, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+				if(connection >= 0) close(connection);
+				connection = -1;
+				stop("InterOp cache server not running at " + socket);
+			}
+			if(!samePeer(connection)) {
+				close(connection);
+				connection = -1;
+				stop("The InterOp cache server at " + socket + " runs as another user");
+			}
+			connectionPid = getpid();
+			connectionBuf.clear();
+		}
+
+		std::string reply;
+		if(sendLine(connection, line)) {
+			char buf[4096];
+			while(!nextLine(connectionBuf, reply)) {
+				ssize_t n = recv(connection, buf, sizeof(buf), 0);
+				if(n < 0 && errno == EINTR) continue;
+				if(n <= 0) break;
+				connectionBuf.append(buf, n);
+			}
+			if(!reply.empty()) return reply;
+		}
+		close(connection);
+		connection = -1;
+	}
+	stop("Lost connection to the InterOp cache server");
+	return "";
+}
+
+/*
+ * ALTREP vectors over the mapping. data1: list(mapping, c(offset, length)).
+ * The segment is mapped private (copy-on-write): every access, including
+ * INTEGER()/REAL() from compiled code asking for a writeable pointer, reads
+ * the pages shared by all the workers. If R modifies a column in place, the
+ * kernel copies only the touched pages into this process; the segment and
+ * the other workers never see the change
+ */
+static R_altrep_class_t shmInteger, shmReal;
+
+static R_xlen_t shmLength(SEXP x) {
+	return (R_xlen_t)REAL(VECTOR_ELT(R_altrep_data1(x), 1))[1];
+}
+
+static void *shmAddr(SEXP x) {
+	SEXP d1 = R_altrep_data1(x);
+	Mapping *m = (Mapping *)R_ExternalPtrAddr(VECTOR_ELT(d1, 0));
+	return (char *)m->addr + (uint64_t)REAL(VECTOR_ELT(d1, 1))[0];
+}
+
+static size_t shmWidth(SEXP x) {
+	return TYPEOF(x) == INTSXP ? sizeof(int) : sizeof(double);
+}
+
+static void *shmDataptr(SEXP x, Rboolean writeable) {
+	return shmAddr(x);
+}
+
+static const void *shmDataptrOrNull(SEXP x) {
+	return shmAddr(x);
+}
+
+static SEXP shmCopy(SEXP x) {
+	SEXP y = PROTECT(Rf_allocVector(TYPEOF(x), shmLength(x)));
+	memcpy(TYPEOF(x) == INTSXP ? (void *)INTEGER(y) : (void *)REAL(y), shmAddr(x), shmLength(x) * shmWidth(x));
+	UNPROTECT(1);
+	return y;
+}
+
+static int shmIntegerElt(SEXP x, R_xlen_t i) {
+	return ((const int *)shmAddr(x))[i];
+}
+
+static double shmRealElt(SEXP x, R_xlen_t i) {
+	return ((const double *)shmAddr(x))[i];
+}
+
+static R_xlen_t shmGetRegion(SEXP x, R_xlen_t i, R_xlen_t n, void *buf) {
+	R_xlen_t l = shmLength(x);
+	if(i >= l) return 0;
+	n = std::min(n, l - i);
+	memcpy(buf, (const char *)shmAddr(x) + i * shmWidth(x), n * shmWidth(x));
+	return n;
+}
+
+static R_xlen_t shmIntegerGetRegion(SEXP x, R_xlen_t i, R_xlen_t n, int *buf) {
+	return shmGetRegion(x, i, n, buf);
+}
+
+static R_xlen_t shmRealGetRegion(SEXP x, R_xlen_t i, R_xlen_t n, double *buf) {
+	return shmGetRegion(x, i, n, buf);
+}
+
+// serialized (saveRDS, sending to other processes...) as plain vectors
+static SEXP shmSerializedState(SEXP x) {
+	return shmCopy(x);
+}
+
+static SEXP shmUnserialize(SEXP cls, SEXP state) {
+	return state;
+}
+
+static SEXP shmDuplicate(SEXP x, Rboolean deep) {
+	return shmCopy(x);
+}
+
+static Rboolean shmInspect(SEXP x, int pre, int deep, int pvec, void (*inspect)(SEXP, int, int, int)) {
+	Rprintf(" InterOp shared memory column\n");
+	return TRUE;
+}
+
+static void registerClass(R_altrep_class_t& cls, bool integer, DllInfo *dll) {
+	cls = integer ? R_make_altinteger_class("shm_integer", "InterOp", dll) : R_make_altreal_class("shm_real", "InterOp", dll);
+	R_set_altrep_Length_method(cls, shmLength);
+	R_set_altrep_Inspect_method(cls, shmInspect);
+	R_set_altrep_Duplicate_method(cls, shmDuplicate);
+	R_set_altrep_Serialized_state_method(cls, shmSerializedState);
+	R_set_altrep_Unserialize_method(cls, shmUnserialize);
+	R_set_altvec_Dataptr_method(cls, shmDataptr);
+	R_set_altvec_Dataptr_or_null_method(cls, shmDataptrOrNull);
+	if(integer) {
+		R_set_altinteger_Elt_method(cls, shmIntegerElt);
+		R_set_altinteger_Get_region_method(cls, shmIntegerGetRegion);
+	} else {
+		R_set_altreal_Elt_method(cls, shmRealElt);
+		R_set_altreal_Get_region_method(cls, shmRealGetRegion);
+	}
+}
+
+extern "C" void R_init_InterOp(DllInfo *dll) {
+	registerClass(shmInteger, true, dll);
+	registerClass(shmReal, false, dll);
+}
+
+static SEXP shmColumn(SEXP mapping, const ColumnHeader& c) {
+
+	if(c.type == STRSXP) {	// small (control metrics): materialized
+		std::vector<std::string> s;
+		const char *p = (const char *)((Mapping *)R_ExternalPtrAddr(mapping))->addr + c.offset, *end = p + c.bytes;
+		for(; p < end; p += strlen(p) + 1) s.push_back(p);
+		return Rcpp::wrap(s);
+	}
+
+	R_xlen_t n = c.bytes / (c.type == INTSXP ? sizeof(int) : sizeof(double));
+	Rcpp::NumericVector meta = Rcpp::NumericVector::create((double)c.offset, (double)n);
+	Rcpp::List d1 = Rcpp::List::create(mapping, meta);
+	Rcpp::RObject x = R_new_altrep(c.type == INTSXP ? shmInteger : shmReal, d1, R_NilValue);
+	if(c.ncol) x.attr("dim") = Rcpp::IntegerVector::create(n / c.ncol, c.ncol);
+	return x;
+}
+
+/*
+ * check every header of the segment against the size of the mapping before
+ * building any vector on it
+ */
+static bool validSegment(const char *addr, uint64_t size) {
+
+	if(size < sizeof(SegmentHeader)) return false;
+	const SegmentHeader *h = (const SegmentHeader *)addr;
+	if(h->magic != SEGMENT_MAGIC || h->ntables > 64) return false;
+
+	uint64_t p = sizeof(SegmentHeader);
+	for(uint32_t i=0; i < h->ntables; i++) {
+		if(size - p < sizeof(TableHeader)) return false;
+		const TableHeader *th = (const TableHeader *)(addr + p);
+		p += sizeof(TableHeader);
+		if(memchr(th->name, 0, sizeof(th->name)) == NULL || th->ncols > 256 || th->nrows > INT_MAX) return false;
+		if((size - p) / sizeof(ColumnHeader) < th->ncols) return false;
+
+		for(uint32_t j=0; j < th->ncols; j++) {
+			const ColumnHeader *c = (const ColumnHeader *)(addr + p);
+			p += sizeof(ColumnHeader);
+			if(memchr(c->name, 0, sizeof(c->name)) == NULL) return false;
+			if(c->offset > size || c->bytes > size - c->offset || c->offset % 8) return false;
+			if(c->type == STRSXP) {
+				if(c->ncol || (c->bytes && addr[c->offset + c->bytes - 1] != '\0')) return false;
+				continue;
+			}
+			if(c->type != INTSXP && c->type != REALSXP) return false;
+			uint64_t width = c->type == INTSXP ? sizeof(int) : sizeof(double), n = c->bytes / width;
+			if(c->bytes % width) return false;
+			if(c->ncol ? n % c->ncol != 0 : n != th->nrows) return false;
+		}
+	}
+	return true;
+}
+
+// [[Rcpp::export]]
+Rcpp::List interOpCacheGet(std::string path, std::string socket) {
+
+	std::string reply = request(socket, "GET " + path);
+	if(reply.compare(0, 3, "OK ") != 0) stop(reply.compare(0, 4, "ERR ") == 0 ? reply.substr(4) : "Unexpected reply from the InterOp cache");
+	std::string segment = reply.substr(3);
+	if(segment.compare(0, 9, "/InterOp.") != 0 || segment.find('/', 1) != std::string::npos || segment.size() > 64) {
+		sendLine(connection, "RELEASE " + segment);
+		stop("Unexpected reply from the InterOp cache");
+	}
+
+	// map the segment (private, see above); from now on the reference is released by the finalizer
+	int fd = shm_open(segment.c_str(), O_RDONLY, 0);
+	struct stat st;
+	if(fd < 0 || fstat(fd, &st) != 0 || st.st_uid != getuid() || st.st_size <= 0) {
+		if(fd >= 0) close(fd);
+		sendLine(connection, "RELEASE " + segment);
+		stop("Could not open shared memory segment " + segment);
+	}
+	void *addr = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if(addr == MAP_FAILED) {
+		sendLine(connection, "RELEASE " + segment);
+		stop("Could not map shared memory segment " + segment);
+	}
+
+	Mapping *m = new Mapping;
+	m->addr    = addr;
+	m->bytes   = st.st_size;
+	m->segment = segment;
+	m->pid     = getpid();
+	Rcpp::RObject mapping = R_MakeExternalPtr(m, R_NilValue, R_NilValue);
+	R_RegisterCFinalizerEx(mapping, finalizeMapping, TRUE);
+
+	if(!validSegment((const char *)addr, st.st_size)) stop("Corrupted shared memory segment " + segment);
+	const SegmentHeader *h = (const SegmentHeader *)addr;
+
+	// one data.frame per table; tables with matrix columns become list(key = df, <matrix> = matrix)
+	Rcpp::List run(h->ntables);
+	std::vector<std::string> tableNames;
+	const char *p = (const char *)addr + sizeof(SegmentHeader);
+	for(uint32_t i=0; i < h->ntables; i++) {
+		const TableHeader *th = (const TableHeader *)p;
+		const ColumnHeader *ch = (const ColumnHeader *)(p + sizeof(TableHeader));
+		p += sizeof(TableHeader) + th->ncols * sizeof(ColumnHeader);
+		tableNames.push_back(th->name);
+
+		Rcpp::List df, extra;
+		std::vector<std::string> dfNames, extraNames;
+		for(uint32_t j=0; j < th->ncols; j++) {
+			if(ch[j].ncol) { extra.push_back(shmColumn(mapping, ch[j])); extraNames.push_back(ch[j].name); }
+			else           { df.push_back(shmColumn(mapping, ch[j]));    dfNames.push_back(ch[j].name); }
+		}
+		df.attr("names")     = Rcpp::wrap(dfNames);
+		df.attr("class")     = "data.frame";
+		df.attr("row.names") = Rcpp::IntegerVector::create(NA_INTEGER, -(int)th->nrows);
+
+		if(extra.size() == 0) {
+			run[i] = df;
+		} else {
+			extra.push_front(df);
+			extraNames.insert(extraNames.begin(), "key");
+			extra.attr("names") = Rcpp::wrap(extraNames);
+			run[i] = extra;
+		}
+	}
+	run.attr("names") = Rcpp::wrap(tableNames);
+	return run;
+}
@@ -0,0 +1,127 @@
+#ifndef INTEROP_RECORDS_H
+#define INTEROP_RECORDS_H
+
+#include <stdint.h>
+
+/***************************************
+ *
+ * fixed length register definitions of the InterOp files, shared by the
+ * readers (InterOp.cpp) and the Arrow export (InterOpArrow.cpp)
+ *
+ ***************************************/
+
+// ExtractionMetricsOut.bin
+// bytes (N * 38 + 2) - (N * 38 + 39): record: (N is the record index)
+#pragma pack(push, 1)
+struct ExtractionMetrics {
+	uint16_t lane;	// 2 bytes: lane number
+	uint16_t tile;	// 2 bytes: tile number
+	uint16_t cycle;	// 2 bytes: cycle number
+	//unsigned char padding[2];		// here the struct should be padded, but the file is not
+	float    fwhmA;	// 4 bytes: fwhm scores for channel A respectively
+	float    fwhmC;	// 4 bytes: fwhm scores for channel C respectively
+	float    fwhmG;	// 4 bytes: fwhm scores for channel G respectively
+	float    fwhmT;	// 4 bytes: fwhm scores for channel T respectively
+	uint16_t intA;	// 2 bytes: intensities for channel A respectively
+	uint16_t intC;	// 2 bytes: intensities for channel C respectively
+	uint16_t intG;	// 2 bytes: intensities for channel G respectively
+	uint16_t intT;	// 2 bytes: intensities for channel T respectively
+	uint64_t datetime;	// 8 bytes: date/time of CIF creation (.Net timestamp (100 nanosec tics from 01-01-0001))
+};
+#pragma pack(pop)
+
+// QMetricsOut.bin
+// bytes (N * 206 + 2) - (N * 206 + 207): record: (N is the record index)
+#pragma pack(push, 1)
+struct QualityMetrics {
+	uint16_t lane;	// 2 bytes: lane number
+	uint16_t tile;	// 2 bytes: tile number
+	uint16_t cycle;	// 2 bytes: metric cycle
+	uint32_t nclust[50];	// number of clusters assigned score Q1 through Q50
+};
+#pragma pack(pop)
+
+// ErrorMetricsOut.bin
+// bytes (N * 30 + 2) - (N * 30 + 31): record: (N is the record index)
+#pragma pack(push, 1)
+struct ErrorMetrics {
+	uint16_t lane;	// 2 bytes: lane number
+	uint16_t tile;	// 2 bytes: tile number
+	uint16_t cycle;	// 2 bytes: cycle number
+	//unsigned char padding[2];		// here the struct should be padded, but the file is not
+	float    erate;	// 4 bytes: error rate
+	uint32_t n;		// 4 bytes: number of perfect reads
+	uint32_t n1e;	// 4 bytes: number of reads with 1 error
+	uint32_t n2e;	// 4 bytes: number of reads with 2 errors
+	uint32_t n3e;	// 4 bytes: number of reads with 3 errors
+	uint32_t n4e;	// 4 bytes: number of reads with 4 errors
+};
+#pragma pack(pop)
+
+// TileMetricsOut.bin
+// bytes (N * 10 + 2) - (N * 10 + 11): record: (N is the record index)
+#pragma pack(push, 1)
+struct TileMetrics {
+	uint16_t lane;	// 2 bytes: lane number
+	uint16_t tile;	// 2 bytes: tile number
+	uint16_t code;	// 2 bytes: metric code
+	float    value;	// 4 bytes: metric value
+};
+/* possible metric codes are:
+ * code 100: cluster density (k/mm2)
+ * code 101: cluster density passing filters (k/mm2)
+ * code 102: number of clusters
+ * code 103: number of clusters passing filters
+ * code (200 + (N – 1) * 2): phasing for read N
+ * code (201 + (N – 1) * 2): prephasing for read N
+ * code (300 + N – 1): percent aligned for read N
+ * code 400: control lane */
+#pragma pack(pop)
+
+// CorrectedIntMetricsOut.bin
+// bytes (N * 48 + 2) - (N * 48 + 49): record: (N is the record index)
+#pragma pack(push, 1)
+struct CorrectedIntMetrics {
+	uint16_t lane;			// 2 bytes: lane number
+	uint16_t tile;      	// 2 bytes: tile number
+	uint16_t cycle;     	// 2 bytes: cycle number
+	uint16_t avgint;    	// 2 bytes: average intensity
+	uint16_t avgintA;   	// 2 bytes: average corrected int for channel A
+	uint16_t avgintC;   	// 2 bytes: average corrected int for channel C
+	uint16_t avgintG;   	// 2 bytes: average corrected int for channel G
+	uint16_t avgintT;   	// 2 bytes: average corrected int for channel T
+	uint16_t avgintclA; 	// 2 bytes: average corrected int for called clusters for base A
+	uint16_t avgintclC; 	// 2 bytes: average corrected int for called clusters for base C
+	uint16_t avgintclG; 	// 2 bytes: average corrected int for called clusters for base G
+	uint16_t avgintclT; 	// 2 bytes: average corrected int for called clusters for base T
+	float    bcNC;      	// 4 bytes: number of base calls for No Call
+	float    bcA;       	// 4 bytes: number of base calls for channel A
+	float    bcC;       	// 4 bytes: number of base calls for channel C
+	float    bcG;       	// 4 bytes: number of base calls for channel G
+	float    bcT;       	// 4 bytes: number of base calls for channel T
+	float    srratio;   	// 4 bytes: signal to noise ratio
+};
+#pragma pack(pop)
+
+// ImageMetricsOut.bin
+// bytes (N * 12 + 2) - (N * 12 + 13): record: (N is the record index)
+#pragma pack(push, 1)
+struct ImageMetrics {
+	uint16_t lane;	// 2 bytes: lane number
+	uint16_t tile;	// 2 bytes: tile number
+	uint16_t cycle;	// 2 bytes: cycle number
+	uint16_t channelid;	// 2 bytes: channel id where 0=A, 1=C, 2=G, 3=T
+	uint16_t mincont;	// 2 bytes: min contrast value for image
+	uint16_t maxcont;	// 2 bytes: max contrast value for image
+};
+#pragma pack(pop)
+
+// the files are not padded: any change in the definitions above breaks the readers
+static_assert(sizeof(ExtractionMetrics) == 38, "ExtractionMetrics record length");
+static_assert(sizeof(QualityMetrics) == 206, "QualityMetrics record length");
+static_assert(sizeof(ErrorMetrics) == 30, "ErrorMetrics record length");
+static_assert(sizeof(TileMetrics) == 10, "TileMetrics record length");
+static_assert(sizeof(CorrectedIntMetrics) == 48, "CorrectedIntMetrics record length");
+static_assert(sizeof(ImageMetrics) == 12, "ImageMetrics record length");
+
+#endif
@@ -110,3 +110,47 @@ BEGIN_RCPP
     return __sexp_result;
 END_RCPP
 }
+// exportInterOpArrow
+void exportInterOpArrow(CharacterVector f, std::string table, SEXP array, SEXP schema);
+RcppExport SEXP InterOp_exportInterOpArrow(SEXP fSEXP, SEXP tableSEXP, SEXP arraySEXP, SEXP schemaSEXP) {
+BEGIN_RCPP
+    {
+        Rcpp::RNGScope __rngScope;
+        Rcpp::traits::input_parameter< CharacterVector >::type f(fSEXP );
+        Rcpp::traits::input_parameter< std::string >::type table(tableSEXP );
+        Rcpp::traits::input_parameter< SEXP >::type array(arraySEXP );
+        Rcpp::traits::input_parameter< SEXP >::type schema(schemaSEXP );
+        exportInterOpArrow(f, table, array, schema);
+    }
+    return R_NilValue;
+END_RCPP
+}
+// runInterOpCacheServer
+void runInterOpCacheServer(std::string socket, double maxMB);
+RcppExport SEXP InterOp_runInterOpCacheServer(SEXP socketSEXP, SEXP maxMBSEXP) {
+BEGIN_RCPP
+    {
+        Rcpp::RNGScope __rngScope;
+        Rcpp::traits::input_parameter< std::string >::type socket(socketSEXP );
+        Rcpp::traits::input_parameter< double >::type maxMB(maxMBSEXP );
+        runInterOpCacheServer(socket, maxMB);
+    }
+    return R_NilValue;
+END_RCPP
+}
+// interOpCacheGet
+Rcpp::List interOpCacheGet(std::string path, std::string socket);
+RcppExport SEXP InterOp_interOpCacheGet(SEXP pathSEXP, SEXP socketSEXP) {
+BEGIN_RCPP
+    SEXP __sexp_result;
+    {
+        Rcpp::RNGScope __rngScope;
+        Rcpp::traits::input_parameter< std::string >::type path(pathSEXP );
+        Rcpp::traits::input_parameter< std::string >::type socket(socketSEXP );
+        Rcpp::List __result = interOpCacheGet(path, socket);
+        PROTECT(__sexp_result = Rcpp::wrap(__result));
+    }
+    UNPROTECT(1);
+    return __sexp_result;
+END_RCPP
+}
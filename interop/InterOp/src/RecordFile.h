@@ -0,0 +1,103 @@
+#ifndef INTEROP_RECORDFILE_H
+#define INTEROP_RECORDFILE_H
+
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <algorithm>
+#include <string>
+#include <thread>
+#include <vector>
+#include <Rcpp.h>
+
+/***************************************
+ *
+ * fixed record length files:
+ *   byte 0: file version number
+ *   byte 1: length of each record
+ *   bytes (N * length + 2) - (N * length + length + 1): record N
+ * the file is mapped in memory, so every thread reads its records directly
+ *
+ ***************************************/
+class RecordFile {
+public:
+	typedef unsigned char BYTE;
+	BYTE version;
+	BYTE length;
+	int  n;	// number of records
+
+	RecordFile(const std::string& fx, size_t size) : data(NULL), bytes(0) {
+		int fd = open(fx.c_str(), O_RDONLY);
+		struct stat st;
+		if(fd < 0 || fstat(fd, &st) != 0 || st.st_size < 2) {
+			if(fd >= 0) close(fd);
+			Rcpp::stop("Could not open specified file");
+		}
+		bytes = st.st_size;
+		data  = (const BYTE *)mmap(NULL, bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+		close(fd);
+		if(data == MAP_FAILED) Rcpp::stop("Could not open specified file");
+		madvise((void *)data, bytes, MADV_SEQUENTIAL);
+
+		version = data[0];
+		length  = data[1];
+		if(length < size) {
+			munmap((void *)data, bytes);
+			Rcpp::stop("Unexpected record length in file header");
+		}
+		n = (bytes - 2) / length;	// a trailing partial record is ignored
+	}
+	~RecordFile() { munmap((void *)data, bytes); }
+
+	const BYTE *record(int i) const { return data + 2 + (size_t)i * length; }
+
+private:
+	const BYTE *data;
+	size_t bytes;
+};
+
+/***************************************
+ *
+ * split the records in record-aligned chunks, one per thread, and call
+ * chunk(begin, end) for each one. Threads write disjoint slices of the
+ * preallocated outputs, so no locking or merging is needed
+ *
+ ***************************************/
+// options(InterOp.threads = n) caps the threads (all the cores by default). Set it when
+// several processes decode at the same time (Shiny workers, mclapply...)
+static int decodeThreads() {
+	SEXP opt = Rf_GetOption1(Rf_install("InterOp.threads"));
+	int n = Rf_isNull(opt) ? 0 : Rf_asInteger(opt);
+	return n > 0 ? n : std::max(1, (int)std::thread::hardware_concurrency());
+}
+
+template<typename F>
+static void forRecords(const RecordFile& in, F chunk) {
+
+	const int MIN_CHUNK = 1 << 16;	// records per thread below which threads don't pay off
+	int threads = std::max(1, std::min(decodeThreads(), in.n / MIN_CHUNK));
+
+	std::vector<std::thread> pool;
+	int step = (in.n + threads - 1) / threads;
+	for(int t=1; t < threads; t++) {
+		pool.push_back(std::thread(chunk, std::min(in.n, t * step), std::min(in.n, (t + 1) * step)));
+	}
+	chunk(0, std::min(in.n, step));
+	for(size_t t=0; t < pool.size(); t++) pool[t].join();
+}
+
+// decode(i, reg) for every record, copied into its register definition
+template<typename Reg, typename F>
+static void decodeRecords(const RecordFile& in, F decode) {
+	forRecords(in, [&](int b, int e) {
+		Reg reg;
+		for(int i=b; i < e; i++) {
+			memcpy(&reg, in.record(i), sizeof(reg));
+			decode(i, reg);
+		}
+	});
+}
+
+#endif